@@ -0,0 +1,56 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#ifndef _app_keys_h
+#define _app_keys_h
+
+// AppMessage keys, must match "appKeys" in appinfo.json
+#define KEY_STOP_ID 0
+#define KEY_ROUTE_FILTER 1
+#define KEY_DEPARTURES 2
+#define KEY_ROUTES 3
+#define KEY_TRIP_FROM 4
+#define KEY_TRIP_TO 5
+#define KEY_TRIP_LEGS 6
+#define KEY_TIMETABLE_VERSION 7
+#define KEY_TIMETABLE_CHECKSUMS 8
+#define KEY_TIMETABLE_BLOCK 9
+#define KEY_TIMETABLE_COMMIT 10
+#define KEY_DEPARTURES_ERROR 11
+#define KEY_TIMETABLE_REJECTED 12
+#define KEY_TRIP_ERROR 13
+
+// Persistent storage keys
+#define PERSIST_KEY_COMMUTE_WINDOWS 1
+#define PERSIST_KEY_TIMETABLE_MANIFEST 2
+#define PERSIST_KEY_NAV_STATE 3
+#define PERSIST_KEY_TIMETABLE_REJECTED 4
+#define PERSIST_KEY_ROUTE_ALLOW_LIST 0x10000 // + stop_id, no longer written
+#define PERSIST_KEY_ROUTE_FILTER 0x40000 // + stop_id
+#define PERSIST_KEY_DEPARTURE_CACHE 0x20000 // + slot
+#define PERSIST_KEY_TIMETABLE_CHUNK 0x30000 // + chunk
+
+#endif
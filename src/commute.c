@@ -0,0 +1,97 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "commute.h"
+#include "app_keys.h"
+
+#include "log.h"
+
+#define SCHEDULE_ATTEMPTS 3
+
+int commute_load(CommuteWindow *windows)
+{
+   if (!persist_exists(PERSIST_KEY_COMMUTE_WINDOWS)) return 0;
+   
+   int bytes = persist_read_data(PERSIST_KEY_COMMUTE_WINDOWS, windows, COMMUTE_MAX_WINDOWS * sizeof(CommuteWindow));
+   
+   return (bytes > 0) ? bytes / sizeof(CommuteWindow) : 0;
+}// End of commute_load method
+
+void commute_save(const CommuteWindow *windows, int num_windows)
+{
+   info("Saving %d commute windows", num_windows);
+   
+   if (num_windows == 0)
+   {
+      persist_delete(PERSIST_KEY_COMMUTE_WINDOWS);
+      return;
+   }// End of if
+   
+   int bytes = persist_write_data(PERSIST_KEY_COMMUTE_WINDOWS, windows, num_windows * sizeof(CommuteWindow));
+   if (bytes < 0) error("Unable to save commute windows: %d", bytes);
+}// End of commute_save method
+
+int commute_find(const CommuteWindow *windows, int num_windows, int stop_id)
+{
+   for (int x = 0; x < num_windows; ++x)
+   {
+      if (windows[x].stop_id == stop_id) return x;
+   }// End of for
+   
+   return -1;
+}// End of commute_find method
+
+void commute_schedule(void)
+{
+   CommuteWindow windows[COMMUTE_MAX_WINDOWS];
+   int num_windows = commute_load(windows);
+   
+   // Commutes are the only wakeups this app uses
+   wakeup_cancel_all();
+   
+   time_t prefetch_time;
+   int next = commute_next_prefetch(windows, num_windows, time(NULL), &prefetch_time);
+   
+   if (next < 0)
+   {
+      debug("No commute to schedule");
+      return;
+   }// End of if
+   
+   // Another app may hold a wakeup at the same time, so try a little earlier
+   for (int x = 0; x < SCHEDULE_ATTEMPTS; ++x)
+   {
+      WakeupId id = wakeup_schedule(prefetch_time - x * COMMUTE_SCHEDULE_MARGIN, windows[next].stop_id, false);
+      
+      if (id >= 0)
+      {
+         info("Scheduled prefetch of stop %d at %d", windows[next].stop_id, (int)(prefetch_time - x * COMMUTE_SCHEDULE_MARGIN));
+         return;
+      }// End of if
+      
+      warn("Unable to schedule prefetch of stop %d: %d", windows[next].stop_id, (int)id);
+   }// End of for
+}// End of commute_schedule method
@@ -0,0 +1,42 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "commute_time.h"
+
+#ifndef _commute_h
+#define _commute_h
+
+#define COMMUTE_MAX_WINDOWS 4
+
+int commute_load(CommuteWindow *windows);
+void commute_save(const CommuteWindow *windows, int num_windows);
+
+int commute_find(const CommuteWindow *windows, int num_windows, int stop_id);
+
+// Replaces any pending wakeup with one for the next commute
+void commute_schedule(void);
+
+#endif
@@ -0,0 +1,302 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "commute_editor.h"
+
+#include "log.h"
+
+#define FIELD_HOUR 0
+#define FIELD_MINUTE 1
+#define FIELD_DAYS 2
+#define FIELDS_LENGTH 3
+
+#define MINUTE_STEP 5
+#define TEXT_LENGTH 12
+
+static const uint8_t DAYS[] = { COMMUTE_DAYS_WEEKDAYS, COMMUTE_DAYS_WEEKENDS, COMMUTE_DAYS_DAILY };
+static const char *DAYS_NAMES[] = { "Weekdays", "Weekends", "Daily" };
+#define DAYS_LENGTH 3
+
+struct commute_editor
+{
+   CommuteEditorCompleteCallback success_callback;
+   CommuteEditorCancelledCallback failure_callback;
+   void *context;
+   
+   CommuteWindow commute;
+   
+   Window *window;
+   
+   char texts[FIELDS_LENGTH][TEXT_LENGTH];
+   TextLayer *field_layers[FIELDS_LENGTH];
+   TextLayer *separator_layer;
+   int active_field;
+} __attribute__((aligned(1)));
+
+static int commute_editor_days_index(CommuteEditor ce)
+{
+   for (int x = 0; x < DAYS_LENGTH; ++x)
+   {
+      if (DAYS[x] == ce->commute.days) return x;
+   }// End of for
+   
+   return -1;
+}// End of commute_editor_days_index method
+
+static void commute_editor_update(CommuteEditor ce)
+{
+   int days = commute_editor_days_index(ce);
+   
+   snprintf(ce->texts[FIELD_HOUR], TEXT_LENGTH, "%02d", ce->commute.hour);
+   snprintf(ce->texts[FIELD_MINUTE], TEXT_LENGTH, "%02d", ce->commute.minute);
+   snprintf(ce->texts[FIELD_DAYS], TEXT_LENGTH, "%s", (days >= 0) ? DAYS_NAMES[days] : "Custom");
+   
+   for (int x = 0; x < FIELDS_LENGTH; ++x)
+   {
+      text_layer_set_text(ce->field_layers[x], ce->texts[x]);
+   }// End of for
+}// End of commute_editor_update method
+
+static void commute_editor_activate_field(CommuteEditor ce, int field)
+{
+   info("Changing active commute field to: %d", field);
+   
+   // deactivate the previous field
+   text_layer_set_background_color(ce->field_layers[ce->active_field], GColorWhite);
+   text_layer_set_text_color(ce->field_layers[ce->active_field], GColorBlack);
+   
+   // activate the new field
+   ce->active_field = field;
+   
+   text_layer_set_background_color(ce->field_layers[ce->active_field], GColorBlack);
+   text_layer_set_text_color(ce->field_layers[ce->active_field], GColorWhite);
+}// End of commute_editor_activate_field method
+
+// Moves the active field up or down by one step, wrapping around
+static void commute_editor_step(CommuteEditor ce, int direction)
+{
+   switch (ce->active_field)
+   {
+      case FIELD_HOUR:
+         ce->commute.hour = (ce->commute.hour + 24 + direction) % 24;
+         break;
+      case FIELD_MINUTE:
+         ce->commute.minute = (ce->commute.minute - ce->commute.minute % MINUTE_STEP + 60 + direction * MINUTE_STEP) % 60;
+         break;
+      default:
+      {
+         int days = commute_editor_days_index(ce);
+         days = (days < 0) ? 0 : (days + DAYS_LENGTH + direction) % DAYS_LENGTH;
+         ce->commute.days = DAYS[days];
+         break;
+      }
+   }// End of switch
+   
+   commute_editor_update(ce);
+}// End of commute_editor_step method
+
+static TextLayer *create_field_layer(GRect frame, const char *font)
+{
+   debug("Creating 'field_layer'");
+   
+   TextLayer *layer = text_layer_create(frame);
+   if (!layer) error("Unable to allocate memory for 'field_layer'");
+   
+   text_layer_set_font(layer, fonts_get_system_font(font));
+   text_layer_set_text_alignment(layer, GTextAlignmentCenter);
+   
+   return layer;
+}// End of create_field_layer method
+
+static void commute_editor_handle_window_load(Window* window)
+{
+   CommuteEditor ce = (CommuteEditor)window_get_user_data(window);
+   
+   // Init GUI components
+   info("Initializing 'commute_editor' GUI components");
+   
+   Layer *window_layer = window_get_root_layer(window);
+   GRect bounds = layer_get_frame(window_layer);
+   
+   int field_width = bounds.size.w * 2 / 5;
+   int top = bounds.size.h / 2 - 42;
+   
+   ce->field_layers[FIELD_HOUR] = create_field_layer((GRect) {
+      .origin = { 0, top },
+      .size = { field_width, 42 }
+   }, FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
+   
+   ce->separator_layer = create_field_layer((GRect) {
+      .origin = { field_width, top },
+      .size = { bounds.size.w - 2 * field_width, 42 }
+   }, FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
+   text_layer_set_text(ce->separator_layer, ":");
+   
+   ce->field_layers[FIELD_MINUTE] = create_field_layer((GRect) {
+      .origin = { bounds.size.w - field_width, top },
+      .size = { field_width, 42 }
+   }, FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
+   
+   ce->field_layers[FIELD_DAYS] = create_field_layer((GRect) {
+      .origin = { 0, top + 48 },
+      .size = { bounds.size.w, 30 }
+   }, FONT_KEY_GOTHIC_24_BOLD);
+   
+   layer_add_child(window_layer, text_layer_get_layer(ce->separator_layer));
+   for (int x = 0; x < FIELDS_LENGTH; ++x)
+   {
+      layer_add_child(window_layer, text_layer_get_layer(ce->field_layers[x]));
+   }// End of for
+   
+   commute_editor_update(ce);
+   
+   // Set selection on the hour
+   commute_editor_activate_field(ce, FIELD_HOUR);
+   
+   heap_usage("commute_editor");
+}// End of commute_editor_handle_window_load method
+
+static void commute_editor_handle_window_unload(Window* window)
+{
+   CommuteEditor ce = (CommuteEditor)window_get_user_data(window);
+   
+   // Unload GUI components
+   info("Destroying 'commute_editor' GUI components");
+   
+   for (int x = 0; x < FIELDS_LENGTH; ++x)
+   {
+      text_layer_destroy(ce->field_layers[x]);
+      ce->field_layers[x] = NULL;
+   }// End of for
+   
+   text_layer_destroy(ce->separator_layer);
+   ce->separator_layer = NULL;
+}// End of commute_editor_handle_window_unload method
+
+static void commute_editor_back_click_handler(ClickRecognizerRef recognizer, void *context)
+{
+   CommuteEditor ce = (CommuteEditor)context;
+   
+   info("Back button clicked on 'commute_editor' window");
+   
+   if (ce->active_field > 0)
+   {
+      commute_editor_activate_field(ce, ce->active_field - 1);
+   }// End of if
+   else
+   {
+      commute_editor_hide(ce);
+      if (ce->failure_callback) ce->failure_callback(ce->context);
+   }// End of else
+}// End of commute_editor_back_click_handler method
+
+static void commute_editor_select_click_handler(ClickRecognizerRef recognizer, void *context)
+{
+   CommuteEditor ce = (CommuteEditor)context;
+   
+   info("Select button clicked on 'commute_editor' window");
+   
+   if (ce->active_field < FIELDS_LENGTH - 1)
+   {
+      commute_editor_activate_field(ce, ce->active_field + 1);
+   }// End of if
+   else
+   {
+      CommuteWindow commute = ce->commute;
+      commute_editor_hide(ce);
+      if (ce->success_callback) ce->success_callback(commute, ce->context);
+   }// End of else
+}// End of commute_editor_select_click_handler method
+
+static void commute_editor_up_click_handler(ClickRecognizerRef recognizer, void *context)
+{
+   commute_editor_step((CommuteEditor)context, 1);
+}// End of commute_editor_up_click_handler method
+
+static void commute_editor_down_click_handler(ClickRecognizerRef recognizer, void *context)
+{
+   commute_editor_step((CommuteEditor)context, -1);
+}// End of commute_editor_down_click_handler method
+
+static void commute_editor_window_click_config_provider(void *context)
+{
+   window_single_click_subscribe(BUTTON_ID_BACK, commute_editor_back_click_handler);
+   window_single_click_subscribe(BUTTON_ID_SELECT, commute_editor_select_click_handler);
+   window_single_repeating_click_subscribe(BUTTON_ID_UP, 100, commute_editor_up_click_handler);
+   window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 100, commute_editor_down_click_handler);
+}// End of commute_editor_window_click_config_provider method
+
+CommuteEditor commute_editor_create(CommuteWindow window, CommuteEditorCompleteCallback complete_callback, CommuteEditorCancelledCallback cancelled_callback, void *context)
+{
+   info("Creating 'commute_editor' object");
+   CommuteEditor ce = (CommuteEditor)malloc(sizeof(struct commute_editor));
+   
+   if (!ce) error("Unable to allocate memory for 'commute_editor' object");
+   
+   // Configure Commute Editor
+   ce->success_callback = complete_callback;
+   ce->failure_callback = cancelled_callback;
+   ce->context = context;
+   
+   ce->commute = window;
+   ce->active_field = FIELD_HOUR;
+   ce->separator_layer = NULL;
+   
+   // Configure window
+   ce->window = window_create();
+   
+   if (!(ce->window)) error("Unable to allocate memory for 'window' object");
+   
+   window_set_fullscreen(ce->window, false);
+   window_set_window_handlers(ce->window, (WindowHandlers) {
+      .load = commute_editor_handle_window_load,
+      .unload = commute_editor_handle_window_unload
+   });
+   window_set_click_config_provider_with_context(ce->window, commute_editor_window_click_config_provider, ce);
+   window_set_user_data(ce->window, ce);
+   
+   return ce;
+}// End of commute_editor_create method
+
+void commute_editor_destroy(CommuteEditor ce)
+{
+   info("Destroying 'commute_editor' object");
+   
+   window_destroy(ce->window);
+   free(ce);
+}// End of commute_editor_destroy method
+
+void commute_editor_show(CommuteEditor ce)
+{
+   info("Showing 'commute_editor' window");
+   window_stack_push(ce->window, true);
+}// End of commute_editor_show method
+
+void commute_editor_hide(CommuteEditor ce)
+{
+   info("Hiding 'commute_editor' window");
+   window_stack_remove(ce->window, true);
+}// End of commute_editor_hide method
@@ -0,0 +1,45 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "commute_time.h"
+
+#ifndef _commute_editor_h
+#define _commute_editor_h
+
+// Picks the time and days of a commute, a field at a time like stop_selection
+struct commute_editor;
+typedef struct commute_editor * CommuteEditor;
+
+typedef void (*CommuteEditorCompleteCallback)(CommuteWindow window, void *context);
+typedef void (*CommuteEditorCancelledCallback)(void *context);
+
+CommuteEditor commute_editor_create(CommuteWindow window, CommuteEditorCompleteCallback complete_callback, CommuteEditorCancelledCallback cancelled_callback, void *context);
+void commute_editor_destroy(CommuteEditor ce);
+
+void commute_editor_show(CommuteEditor ce);
+void commute_editor_hide(CommuteEditor ce);
+
+#endif
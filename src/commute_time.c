@@ -0,0 +1,87 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include "commute_time.h"
+
+static time_t commute_occurrence_on(const CommuteWindow *window, time_t now, int day_offset)
+{
+   struct tm tm = *localtime(&now);
+   
+   tm.tm_mday += day_offset;
+   tm.tm_hour = window->hour;
+   tm.tm_min = window->minute;
+   tm.tm_sec = 0;
+   
+   // Let mktime work out whether daylight saving time applies on that day
+   tm.tm_isdst = -1;
+   
+   time_t occurrence = mktime(&tm);
+   
+   if (!(window->days & (1 << localtime(&occurrence)->tm_wday))) return -1;
+   
+   return occurrence;
+}// End of commute_occurrence_on method
+
+time_t commute_next_occurrence(const CommuteWindow *window, time_t now)
+{
+   // A week from today covers every day bit
+   for (int day = 0; day <= 7; ++day)
+   {
+      time_t occurrence = commute_occurrence_on(window, now, day);
+      if (occurrence > now) return occurrence;
+   }// End of for
+   
+   return -1;
+}// End of commute_next_occurrence method
+
+int commute_next_prefetch(const CommuteWindow *windows, int num_windows, time_t now, time_t *prefetch_time)
+{
+   int next = -1;
+   
+   for (int x = 0; x < num_windows; ++x)
+   {
+      time_t occurrence = commute_next_occurrence(&windows[x], now + COMMUTE_PREFETCH_LEAD + COMMUTE_SCHEDULE_MARGIN);
+      if (occurrence < 0) continue;
+      
+      if (next < 0 || occurrence - COMMUTE_PREFETCH_LEAD < *prefetch_time)
+      {
+         next = x;
+         *prefetch_time = occurrence - COMMUTE_PREFETCH_LEAD;
+      }// End of if
+   }// End of for
+   
+   return next;
+}// End of commute_next_prefetch method
+
+int commute_current(const CommuteWindow *windows, int num_windows, time_t now)
+{
+   for (int x = 0; x < num_windows; ++x)
+   {
+      time_t occurrence = commute_occurrence_on(&windows[x], now, 0);
+      
+      if (occurrence >= 0 && now >= occurrence - COMMUTE_PREFETCH_LEAD && now <= occurrence + COMMUTE_ACTIVE_AFTER) return x;
+   }// End of for
+   
+   return -1;
+}// End of commute_current method
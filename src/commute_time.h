@@ -0,0 +1,60 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+// Commute scheduling arithmetic. Only uses the C library so it can be built
+// and tested on a computer (see tests/commute_time_test.c).
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef _commute_time_h
+#define _commute_time_h
+
+// Wake up this long before a commute to fetch its departures
+#define COMMUTE_PREFETCH_LEAD (2 * 60)
+// Launches up to this long after a commute jump straight to its stop
+#define COMMUTE_ACTIVE_AFTER (15 * 60)
+// Wakeups closer than this to now are treated as already handled
+#define COMMUTE_SCHEDULE_MARGIN 60
+
+// Day bits, indexed by tm_wday
+#define COMMUTE_DAYS_WEEKDAYS 0x3E
+#define COMMUTE_DAYS_WEEKENDS 0x41
+#define COMMUTE_DAYS_DAILY 0x7F
+
+typedef struct commute_window
+{
+   uint16_t stop_id;
+   uint8_t hour;
+   uint8_t minute;
+   uint8_t days;
+} __attribute__((__packed__)) CommuteWindow;
+
+// The clock is an argument so a test can pick any time
+time_t commute_next_occurrence(const CommuteWindow *window, time_t now);
+int commute_next_prefetch(const CommuteWindow *windows, int num_windows, time_t now, time_t *prefetch_time);
+int commute_current(const CommuteWindow *windows, int num_windows, time_t now);
+
+#endif
@@ -0,0 +1,119 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "departure_cache.h"
+#include "app_keys.h"
+
+#include "log.h"
+
+// One persisted slot, must fit in PERSIST_DATA_MAX_LENGTH
+typedef struct departure_cache_entry
+{
+   int32_t stop_id;
+   uint32_t fetched;
+   uint8_t num_departures;
+   uint8_t num_routes;
+   Departure departures[DEPARTURES_MAX];
+   uint16_t routes[DEPARTURES_MAX_ROUTES];
+} __attribute__((__packed__)) DepartureCacheEntry;
+
+static bool departure_cache_read(int slot, DepartureCacheEntry *entry)
+{
+   uint32_t key = PERSIST_KEY_DEPARTURE_CACHE + slot;
+   
+   if (!persist_exists(key)) return false;
+   
+   return persist_read_data(key, entry, sizeof(DepartureCacheEntry)) == sizeof(DepartureCacheEntry);
+}// End of departure_cache_read method
+
+void departure_cache_put(int stop_id, const Departure *departures, int num_departures, const uint16_t *routes, int num_routes)
+{
+   info("Caching %d departures for stop: %d", num_departures, stop_id);
+   
+   // Reuse the stop's slot, otherwise replace the oldest
+   int slot = 0;
+   uint32_t oldest = UINT32_MAX;
+   DepartureCacheEntry entry;
+   
+   for (int x = 0; x < DEPARTURE_CACHE_SLOTS; ++x)
+   {
+      if (!departure_cache_read(x, &entry))
+      {
+         if (oldest > 0)
+         {
+            slot = x;
+            oldest = 0;
+         }// End of if
+         continue;
+      }// End of if
+      
+      if (entry.stop_id == stop_id)
+      {
+         slot = x;
+         break;
+      }// End of if
+      
+      if (entry.fetched < oldest)
+      {
+         slot = x;
+         oldest = entry.fetched;
+      }// End of if
+   }// End of for
+   
+   entry.stop_id = stop_id;
+   entry.fetched = time(NULL);
+   entry.num_departures = num_departures;
+   entry.num_routes = num_routes;
+   
+   memcpy(entry.departures, departures, num_departures * sizeof(Departure));
+   memcpy(entry.routes, routes, num_routes * sizeof(uint16_t));
+   
+   int bytes = persist_write_data(PERSIST_KEY_DEPARTURE_CACHE + slot, &entry, sizeof(DepartureCacheEntry));
+   if (bytes < 0) error("Unable to cache departures for stop %d: %d", stop_id, bytes);
+}// End of departure_cache_put method
+
+bool departure_cache_get(int stop_id, Departure *departures, int *num_departures, uint16_t *routes, int *num_routes, time_t *fetched)
+{
+   DepartureCacheEntry entry;
+   
+   for (int x = 0; x < DEPARTURE_CACHE_SLOTS; ++x)
+   {
+      if (!departure_cache_read(x, &entry) || entry.stop_id != stop_id) continue;
+      
+      debug("Found cached departures for stop %d in slot %d", stop_id, x);
+      
+      *num_departures = (entry.num_departures < DEPARTURES_MAX) ? entry.num_departures : DEPARTURES_MAX;
+      *num_routes = (entry.num_routes < DEPARTURES_MAX_ROUTES) ? entry.num_routes : DEPARTURES_MAX_ROUTES;
+      *fetched = entry.fetched;
+      
+      memcpy(departures, entry.departures, *num_departures * sizeof(Departure));
+      memcpy(routes, entry.routes, *num_routes * sizeof(uint16_t));
+      
+      return true;
+   }// End of for
+   
+   return false;
+}// End of departure_cache_get method
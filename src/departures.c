@@ -0,0 +1,194 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "departures.h"
+#include "departure_cache.h"
+#include "message.h"
+#include "app_keys.h"
+
+#include "log.h"
+
+#define TIMEOUT_MS 15000
+
+static int s_stop_id = -1;
+static DeparturesReceivedCallback s_callback = NULL;
+static DeparturesFailedCallback s_failed = NULL;
+static void *s_context = NULL;
+static AppTimer *s_timer = NULL;
+
+// Forgets the pending request
+static void departures_clear(void)
+{
+   if (s_timer) app_timer_cancel(s_timer);
+   
+   s_stop_id = -1;
+   s_callback = NULL;
+   s_failed = NULL;
+   s_context = NULL;
+   s_timer = NULL;
+}// End of departures_clear method
+
+static void departures_fail(void)
+{
+   int stop_id = s_stop_id;
+   DeparturesFailedCallback failed = s_failed;
+   void *failed_context = s_context;
+   
+   departures_clear();
+   
+   if (failed) failed(stop_id, failed_context);
+}// End of departures_fail method
+
+static void departures_timed_out(void *context)
+{
+   warn("Timed out waiting for departures for stop: %d", s_stop_id);
+   
+   s_timer = NULL;
+   departures_fail();
+}// End of departures_timed_out method
+
+static void departures_send_failed(DictionaryIterator *iter, AppMessageResult reason)
+{
+   Tuple *stop_id = dict_find(iter, KEY_STOP_ID);
+   
+   if (!stop_id || (int)stop_id->value->int32 != s_stop_id || !s_callback) return;
+   
+   warn("Unable to deliver departures request for stop %d: %d", s_stop_id, reason);
+   departures_fail();
+}// End of departures_send_failed method
+
+static void departures_received(DictionaryIterator *iter)
+{
+   Tuple *stop_id = dict_find(iter, KEY_STOP_ID);
+   Tuple *departures = dict_find(iter, KEY_DEPARTURES);
+   Tuple *routes = dict_find(iter, KEY_ROUTES);
+   
+   if (!stop_id || !departures)
+   {
+      warn("Ignoring message without departures");
+      return;
+   }// End of if
+   
+   int num_departures = departures->length / sizeof(Departure);
+   if (num_departures > DEPARTURES_MAX) num_departures = DEPARTURES_MAX;
+   
+   int num_routes = routes ? routes->length / sizeof(uint16_t) : 0;
+   if (num_routes > DEPARTURES_MAX_ROUTES) num_routes = DEPARTURES_MAX_ROUTES;
+   
+   info("Received %d departures for stop: %d", num_departures, (int)stop_id->value->int32);
+   
+   // Byte arrays are not aligned within the dictionary
+   Departure received[DEPARTURES_MAX];
+   uint16_t received_routes[DEPARTURES_MAX_ROUTES];
+   
+   memcpy(received, departures->value->data, num_departures * sizeof(Departure));
+   if (routes) memcpy(received_routes, routes->value->data, num_routes * sizeof(uint16_t));
+   
+   for (int x = 0; x < num_departures; ++x)
+   {
+      received[x].headsign[DEPARTURE_HEADSIGN_LENGTH - 1] = '\0';
+   }// End of for
+   
+   // Late replies still warm the cache
+   departure_cache_put(stop_id->value->int32, received, num_departures, received_routes, num_routes);
+   
+   if ((int)stop_id->value->int32 != s_stop_id || !s_callback) return;
+   
+   int callback_stop_id = s_stop_id;
+   DeparturesReceivedCallback callback = s_callback;
+   void *callback_context = s_context;
+   
+   departures_clear();
+   
+   callback(callback_stop_id, received, num_departures, received_routes, num_routes, callback_context);
+}// End of departures_received method
+
+// The phone couldn't fetch departures, so the watch can fall back to its schedule
+static void departures_error_received(DictionaryIterator *iter)
+{
+   Tuple *stop_id = dict_find(iter, KEY_STOP_ID);
+   
+   if (!stop_id || (int)stop_id->value->int32 != s_stop_id || !s_callback) return;
+   
+   warn("Phone unable to fetch departures for stop: %d", s_stop_id);
+   departures_fail();
+}// End of departures_error_received method
+
+void departures_init(void)
+{
+   message_register(KEY_DEPARTURES, departures_received);
+   message_register(KEY_DEPARTURES_ERROR, departures_error_received);
+   message_register_failed(KEY_STOP_ID, departures_send_failed);
+}// End of departures_init method
+
+bool departures_request(int stop_id, RouteFilter rf, DeparturesReceivedCallback callback, DeparturesFailedCallback failed, void *context)
+{
+   info("Requesting departures for stop: %d", stop_id);
+   
+   DictionaryIterator *iter;
+   AppMessageResult result = app_message_outbox_begin(&iter);
+   
+   if (result != APP_MSG_OK)
+   {
+      warn("Unable to begin departures request: %d", result);
+      return false;
+   }// End of if
+   
+   dict_write_int32(iter, KEY_STOP_ID, stop_id);
+   
+   // The phone drops filtered routes before packing the reply
+   int num_routes = 0;
+   const uint16_t *routes = rf ? route_filter_get_routes(rf, &num_routes) : NULL;
+   if (num_routes > 0) dict_write_data(iter, KEY_ROUTE_FILTER, (const uint8_t *)routes, num_routes * sizeof(uint16_t));
+   
+   dict_write_end(iter);
+   
+   result = app_message_outbox_send();
+   if (result != APP_MSG_OK)
+   {
+      warn("Unable to send departures request: %d", result);
+      return false;
+   }// End of if
+   
+   departures_clear();
+   
+   s_stop_id = stop_id;
+   s_callback = callback;
+   s_failed = failed;
+   s_context = context;
+   s_timer = app_timer_register(TIMEOUT_MS, departures_timed_out, NULL);
+   
+   return true;
+}// End of departures_request method
+
+void departures_cancel(void *context)
+{
+   if (s_context != context) return;
+   
+   debug("Cancelling departures request for stop: %d", s_stop_id);
+   
+   departures_clear();
+}// End of departures_cancel method
@@ -0,0 +1,56 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "route_filter.h"
+
+#ifndef _departures_h
+#define _departures_h
+
+#define DEPARTURES_MAX 5
+#define DEPARTURE_HEADSIGN_LENGTH 20
+#define DEPARTURES_MAX_ROUTES ROUTE_FILTER_MAX_ROUTES
+
+// Wire format of a departure, packed little endian by the phone
+typedef struct departure
+{
+   uint16_t route;
+   uint32_t time; // Local time, seconds since the epoch
+   char headsign[DEPARTURE_HEADSIGN_LENGTH];
+} __attribute__((__packed__)) Departure;
+
+// routes lists every route serving the stop, including filtered ones
+typedef void (*DeparturesReceivedCallback)(int stop_id, const Departure *departures, int num_departures, const uint16_t *routes, int num_routes, void *context);
+
+// Called instead when the request can't be delivered, the phone can't fetch
+// departures, or the reply doesn't arrive in time
+typedef void (*DeparturesFailedCallback)(int stop_id, void *context);
+
+void departures_init(void);
+
+bool departures_request(int stop_id, RouteFilter rf, DeparturesReceivedCallback callback, DeparturesFailedCallback failed, void *context);
+void departures_cancel(void *context);
+
+#endif
@@ -25,14 +25,97 @@
 #include <pebble.h>
 
 #include "main_menu.h"
+#include "prefetch.h"
+#include "message.h"
+#include "departures.h"
+#include "departure_cache.h"
+#include "trips.h"
+#include "timetable.h"
+#include "commute.h"
+#include "nav_state.h"
 #include "log.h"
 
+static void handle_wakeup(WakeupId id, int32_t stop_id)
+{
+   // Already open, so the user can see live departures; just move on to the next commute
+   info("Commute wakeup for stop %d while running", (int)stop_id);
+   commute_schedule();
+}// End of handle_wakeup method
+
+// Returns the stop of a commute happening now if its departures are cached
+static int current_commute_stop(void)
+{
+   CommuteWindow windows[COMMUTE_MAX_WINDOWS];
+   int num_windows = commute_load(windows);
+   
+   time_t now = time(NULL);
+   int index = commute_current(windows, num_windows, now);
+   if (index < 0) return -1;
+   
+   Departure departures[DEPARTURES_MAX];
+   uint16_t routes[DEPARTURES_MAX_ROUTES];
+   int num_departures, num_routes;
+   time_t fetched;
+   
+   if (!departure_cache_get(windows[index].stop_id, departures, &num_departures, routes, &num_routes, &fetched)) return -1;
+   if (now - fetched > COMMUTE_PREFETCH_LEAD + COMMUTE_ACTIVE_AFTER) return -1;
+   
+   return windows[index].stop_id;
+}// End of current_commute_stop method
+
+static void prefetch_main(int stop_id)
+{
+   info("Woken up to prefetch stop: %d", stop_id);
+   
+   Prefetch pf = prefetch_create(stop_id);
+   prefetch_show(pf);
+   
+   app_event_loop();
+   
+   prefetch_destroy(pf);
+}// End of prefetch_main method
+
 int main(void)
 {
+   nav_state_mark_launch();
+   
+   message_init();
+   departures_init();
+   trips_init();
+   
+   WakeupId id;
+   int32_t stop_id;
+   
+   if (launch_reason() == APP_LAUNCH_WAKEUP && wakeup_get_launch_event(&id, &stop_id))
+   {
+      prefetch_main(stop_id);
+      
+      commute_schedule();
+      message_deinit();
+      return 0;
+   }// End of if
+   
+   commute_schedule();
+   wakeup_service_subscribe(handle_wakeup);
+   
+   timetable_init();
+   
    MainMenu mm = main_menu_create();
    main_menu_show(mm);
+   
+   // A commute happening now wins over wherever the user left off
+   NavState state;
+   int commute_stop = current_commute_stop();
+   if (commute_stop >= 0) main_menu_show_stop_details(mm, commute_stop, false);
+   else if (nav_state_load(&state)) main_menu_restore(mm, &state);
 
    app_event_loop();
    
+   main_menu_get_nav_state(mm, &state);
+   nav_state_save(&state);
+   
    main_menu_destroy(mm);
+   
+   timetable_deinit();
+   message_deinit();
 }// End of main method
\ No newline at end of file
@@ -0,0 +1,567 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+// Must match src/departures.h
+var DEPARTURES_MAX = 5;
+var DEPARTURE_HEADSIGN_LENGTH = 20;
+var DEPARTURES_MAX_ROUTES = 16;
+
+// Returns a JSON array of { route, headsign, time } for a stop, where time
+// is the departure in seconds since the epoch (UTC)
+var DEPARTURES_URL = 'http://departures.example.com/stops/{stop_id}/departures';
+
+// Must match src/trips.h
+var TRIPS_MAX_LEGS = 6;
+
+// Connection table built by tools/compile_timetable.py for a service date
+var TIMETABLE_URL = 'http://timetable.example.com/grt-{date}.bin';
+var TIMETABLE_MAGIC = 0x43545247; // 'GRTC'
+var TIMETABLE_HEADER_LENGTH = 24;
+
+var MIN_TRANSFER_SECONDS = 60;
+var UNREACHED = 0x7FFFFFFF;
+
+var timetable = null;
+
+// Watch timetable built by tools/compile_timetable.py --watch, must match src/timetable.h
+var WATCH_TIMETABLE_URL = 'http://timetable.example.com/grt-watch.grtt';
+var WATCH_TIMETABLE_MAGIC = 0x54545247; // 'GRTT'
+var TIMETABLE_CHUNK_SIZE = 128;
+
+function writeUint16(bytes, value)
+{
+   bytes.push(value & 0xFF, (value >> 8) & 0xFF);
+}// End of writeUint16 function
+
+function writeUint32(bytes, value)
+{
+   bytes.push(value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >>> 24) & 0xFF);
+}// End of writeUint32 function
+
+// PebbleKit JS won't send an empty byte array, and the watch ignores a
+// trailing partial record
+function nonEmpty(bytes)
+{
+   return bytes.length > 0 ? bytes : [0];
+}// End of nonEmpty function
+
+function readUint16Array(bytes)
+{
+   var values = [];
+
+   for (var x = 0; bytes && x + 1 < bytes.length; x += 2)
+   {
+      values.push(bytes[x] | (bytes[x + 1] << 8));
+   }// End of for
+
+   return values;
+}// End of readUint16Array function
+
+// The watch keeps local time, so departures are shifted into it
+function toWatchTime(utcSeconds)
+{
+   return utcSeconds - new Date(utcSeconds * 1000).getTimezoneOffset() * 60;
+}// End of toWatchTime function
+
+function packDepartures(departures)
+{
+   var bytes = [];
+
+   departures.forEach(function(departure) {
+      writeUint16(bytes, departure.route);
+      writeUint32(bytes, toWatchTime(departure.time));
+
+      for (var x = 0; x < DEPARTURE_HEADSIGN_LENGTH; ++x)
+      {
+         var c = (x < DEPARTURE_HEADSIGN_LENGTH - 1 && x < departure.headsign.length) ? departure.headsign.charCodeAt(x) : 0;
+         bytes.push(c < 128 ? c : 63); // '?' for anything the watch font can't show
+      }// End of for
+   });
+
+   return bytes;
+}// End of packDepartures function
+
+function packRoutes(routes)
+{
+   var bytes = [];
+
+   routes.forEach(function(route) {
+      writeUint16(bytes, route);
+   });
+
+   return bytes;
+}// End of packRoutes function
+
+// Applies the stop's route filter (the routes hidden there) before anything
+// is packed, so hidden routes never cross Bluetooth or take up a row on the watch
+function selectDepartures(departures, routeFilter, now)
+{
+   var upcoming = departures.filter(function(departure) {
+      return departure.time >= now;
+   }).sort(function(a, b) {
+      return a.time - b.time;
+   });
+
+   var routes = [];
+   upcoming.forEach(function(departure) {
+      if (routes.indexOf(departure.route) < 0) routes.push(departure.route);
+   });
+   routes.sort(function(a, b) { return a - b; });
+
+   var selected = upcoming.filter(function(departure) {
+      return routeFilter.indexOf(departure.route) < 0;
+   });
+
+   return {
+      departures: selected.slice(0, DEPARTURES_MAX),
+      routes: routes.slice(0, DEPARTURES_MAX_ROUTES)
+   };
+}// End of selectDepartures function
+
+// Calls back with null when the departures can't be fetched
+function fetchDepartures(stopId, callback)
+{
+   var request = new XMLHttpRequest();
+
+   request.onload = function() {
+      if (request.status !== 200)
+      {
+         console.log('Unable to fetch departures for stop ' + stopId + ': ' + request.status);
+         callback(null);
+         return;
+      }// End of if
+
+      try
+      {
+         callback(JSON.parse(request.responseText));
+      }// End of try
+      catch (e)
+      {
+         console.log('Invalid departures for stop ' + stopId + ': ' + e);
+         callback(null);
+      }// End of catch
+   };
+   request.onerror = function() {
+      console.log('Unable to fetch departures for stop ' + stopId);
+      callback(null);
+   };
+
+   request.open('GET', DEPARTURES_URL.replace('{stop_id}', stopId));
+   request.send();
+}// End of fetchDepartures function
+
+function sendDepartures(stopId, routeFilter)
+{
+   fetchDepartures(stopId, function(departures) {
+      // Tells the watch to use its bundled schedule rather than show no buses
+      if (departures === null)
+      {
+         Pebble.sendAppMessage({ stop_id: stopId, departures_error: 1 }, null, function(e) {
+            console.log('Unable to send departures error for stop ' + stopId);
+         });
+         return;
+      }// End of if
+
+      var selected = selectDepartures(departures, routeFilter, Date.now() / 1000);
+
+      console.log('Sending ' + selected.departures.length + ' departures for stop ' + stopId);
+
+      Pebble.sendAppMessage({
+         stop_id: stopId,
+         departures: nonEmpty(packDepartures(selected.departures)),
+         routes: nonEmpty(packRoutes(selected.routes))
+      }, null, function(e) {
+         console.log('Unable to send departures for stop ' + stopId);
+      });
+   });
+}// End of sendDepartures function
+
+function parseTimetable(buffer)
+{
+   var header = new DataView(buffer, 0, TIMETABLE_HEADER_LENGTH);
+
+   if (header.getUint32(0, true) !== TIMETABLE_MAGIC) throw new Error('Not a timetable');
+
+   var numStops = header.getUint32(12, true);
+   var numTrips = header.getUint32(16, true);
+   var numConnections = header.getUint32(20, true);
+
+   var offset = TIMETABLE_HEADER_LENGTH;
+   function column(Type, length)
+   {
+      var values = new Type(buffer, offset, length);
+      offset += length * Type.BYTES_PER_ELEMENT;
+      return values;
+   }// End of column function
+
+   var tt = {
+      date: header.getUint32(8, true),
+      numStops: numStops,
+      numTrips: numTrips,
+      numConnections: numConnections,
+
+      // Connections, sorted by departure time
+      departures: column(Uint32Array, numConnections),
+      arrivals: column(Uint32Array, numConnections),
+      trips: column(Uint32Array, numConnections),
+      fromStops: column(Uint16Array, numConnections),
+      toStops: column(Uint16Array, numConnections),
+
+      stopNumbers: column(Uint16Array, numStops),
+      tripRoutes: column(Uint16Array, numTrips),
+      stopIndex: {},
+
+      // Scratch space reused by every query
+      ready: new Int32Array(numStops),
+      inConnection: new Int32Array(numStops),
+      boardConnection: new Int32Array(numStops),
+      tripBoarded: new Int32Array(numTrips)
+   };
+
+   for (var x = numStops - 1; x >= 0; --x)
+   {
+      tt.stopIndex[tt.stopNumbers[x]] = x;
+   }// End of for
+
+   return tt;
+}// End of parseTimetable function
+
+// Connection Scan: earliest arrival from one stop to another, leaving at or
+// after departure (seconds after midnight). Returns the legs ridden.
+function planTrip(tt, fromNumber, toNumber, departure)
+{
+   var from = tt.stopIndex[fromNumber];
+   var to = tt.stopIndex[toNumber];
+
+   if (from === undefined || to === undefined || from === to) return [];
+
+   var ready = tt.ready, inConnection = tt.inConnection, boardConnection = tt.boardConnection, tripBoarded = tt.tripBoarded;
+   var departures = tt.departures, arrivals = tt.arrivals, trips = tt.trips, fromStops = tt.fromStops, toStops = tt.toStops;
+   var x;
+
+   for (x = 0; x < tt.numStops; ++x) ready[x] = UNREACHED;
+   for (x = 0; x < tt.numTrips; ++x) tripBoarded[x] = -1;
+
+   ready[from] = departure;
+
+   // First connection leaving at or after the departure time
+   var low = 0, high = tt.numConnections;
+   while (low < high)
+   {
+      var middle = (low + high) >>> 1;
+      if (departures[middle] < departure) low = middle + 1;
+      else high = middle;
+   }// End of while
+
+   for (x = low; x < tt.numConnections; ++x)
+   {
+      var connectionDeparture = departures[x];
+
+      // Nothing leaving later can arrive any earlier
+      if (connectionDeparture >= ready[to]) break;
+
+      var trip = trips[x];
+      var boarded = tripBoarded[trip];
+
+      if (boarded < 0)
+      {
+         if (ready[fromStops[x]] > connectionDeparture) continue;
+         boarded = tripBoarded[trip] = x;
+      }// End of if
+
+      // Arriving somewhere other than the destination means changing buses
+      var stop = toStops[x];
+      var arrival = arrivals[x] + (stop === to ? 0 : MIN_TRANSFER_SECONDS);
+
+      if (arrival < ready[stop])
+      {
+         ready[stop] = arrival;
+         inConnection[stop] = x;
+         boardConnection[stop] = boarded;
+      }// End of if
+   }// End of for
+
+   if (ready[to] === UNREACHED) return [];
+
+   var legs = [];
+   for (var at = to; at !== from && legs.length < tt.numStops; at = fromStops[boardConnection[at]])
+   {
+      var board = boardConnection[at];
+      var alight = inConnection[at];
+
+      legs.unshift({
+         route: tt.tripRoutes[trips[alight]],
+         from: tt.stopNumbers[fromStops[board]],
+         to: tt.stopNumbers[toStops[alight]],
+         departure: departures[board],
+         arrival: arrivals[alight]
+      });
+   }// End of for
+
+   return legs;
+}// End of planTrip function
+
+function serviceDate(date)
+{
+   return date.getFullYear() * 10000 + (date.getMonth() + 1) * 100 + date.getDate();
+}// End of serviceDate function
+
+// Calls back with null unless today's timetable is loaded; another day's
+// service would give trips that look valid but aren't
+function loadTimetable(callback)
+{
+   var today = serviceDate(new Date());
+
+   function done()
+   {
+      callback(timetable && timetable.date === today ? timetable : null);
+   }// End of done function
+
+   if (timetable && timetable.date === today)
+   {
+      callback(timetable);
+      return;
+   }// End of if
+
+   var request = new XMLHttpRequest();
+   request.responseType = 'arraybuffer';
+
+   request.onload = function() {
+      try
+      {
+         if (request.status !== 200) throw new Error('HTTP ' + request.status);
+
+         timetable = parseTimetable(request.response);
+         console.log('Loaded timetable for ' + timetable.date + ' with ' + timetable.numConnections + ' connections');
+      }// End of try
+      catch (e)
+      {
+         console.log('Unable to load timetable: ' + e);
+      }// End of catch
+
+      done();
+   };
+   request.onerror = function() {
+      console.log('Unable to load timetable');
+      done();
+   };
+
+   request.open('GET', TIMETABLE_URL.replace('{date}', today));
+   request.send();
+}// End of loadTimetable function
+
+function packLegs(legs, midnight)
+{
+   var bytes = [];
+
+   legs.slice(0, TRIPS_MAX_LEGS).forEach(function(leg) {
+      writeUint16(bytes, leg.route);
+      writeUint16(bytes, leg.from);
+      writeUint16(bytes, leg.to);
+      writeUint32(bytes, toWatchTime(midnight + leg.departure));
+      writeUint32(bytes, toWatchTime(midnight + leg.arrival));
+   });
+
+   return bytes;
+}// End of packLegs function
+
+function sendTrip(fromStop, toStop)
+{
+   loadTimetable(function(tt) {
+      var midnight = new Date();
+      midnight.setHours(0, 0, 0, 0);
+      midnight = midnight.getTime() / 1000;
+
+      // Tells the watch the trip couldn't be planned rather than that there is none
+      if (!tt)
+      {
+         Pebble.sendAppMessage({ trip_from: fromStop, trip_to: toStop, trip_error: 1 }, null, function(e) {
+            console.log('Unable to send trip error from ' + fromStop + ' to ' + toStop);
+         });
+         return;
+      }// End of if
+
+      var legs = planTrip(tt, fromStop, toStop, Math.floor(Date.now() / 1000 - midnight));
+
+      console.log('Sending trip from ' + fromStop + ' to ' + toStop + ' with ' + legs.length + ' legs');
+
+      Pebble.sendAppMessage({
+         trip_from: fromStop,
+         trip_to: toStop,
+         trip_legs: nonEmpty(packLegs(legs, midnight))
+      }, null, function(e) {
+         console.log('Unable to send trip from ' + fromStop + ' to ' + toStop);
+      });
+   });
+}// End of sendTrip function
+
+function parseWatchTimetable(buffer)
+{
+   var view = new DataView(buffer);
+
+   if (view.getUint32(0, true) !== WATCH_TIMETABLE_MAGIC) throw new Error('Not a watch timetable');
+
+   var blocks = [];
+   for (var x = 0; x < view.getUint16(8, true); ++x)
+   {
+      var entry = 12 + x * 12;
+      blocks.push({
+         stop: view.getUint16(entry, true),
+         crc: view.getUint16(entry + 2, true),
+         data: new Uint8Array(buffer, view.getUint32(entry + 8, true), view.getUint16(entry + 4, true))
+      });
+   }// End of for
+
+   return { version: view.getUint32(4, true), blocks: blocks };
+}// End of parseWatchTimetable function
+
+// Builds the messages that bring the watch from its block checksums to the
+// new timetable: chunk-sized fragments of each changed block, then a commit
+function timetablePatch(watchTimetable, checksums)
+{
+   var watchBlocks = {};
+   for (var x = 0; x + 1 < checksums.length; x += 2)
+   {
+      watchBlocks[checksums[x]] = checksums[x + 1];
+   }// End of for
+
+   var messages = [];
+   var changed = 0;
+
+   function addBlock(stop, crc, data)
+   {
+      var offset = 0;
+      do
+      {
+         var fragment = [];
+         writeUint16(fragment, stop);
+         writeUint16(fragment, crc);
+         writeUint16(fragment, data.length);
+         writeUint16(fragment, offset);
+
+         for (var y = offset; y < data.length && y < offset + TIMETABLE_CHUNK_SIZE; ++y) fragment.push(data[y]);
+
+         messages.push({ timetable_version: watchTimetable.version, timetable_block: fragment });
+         offset += TIMETABLE_CHUNK_SIZE;
+      } while (offset < data.length);
+
+      ++changed;
+   }// End of addBlock function
+
+   watchTimetable.blocks.forEach(function(block) {
+      if (watchBlocks[block.stop] !== block.crc) addBlock(block.stop, block.crc, block.data);
+      delete watchBlocks[block.stop];
+   });
+
+   // Stops dropped from the timetable
+   Object.keys(watchBlocks).forEach(function(stop) {
+      addBlock(Number(stop), 0, []);
+   });
+
+   messages.push({ timetable_version: watchTimetable.version, timetable_commit: changed });
+
+   return messages;
+}// End of timetablePatch function
+
+function sendMessages(messages, index)
+{
+   if (index >= messages.length) return;
+
+   Pebble.sendAppMessage(messages[index], function(e) {
+      sendMessages(messages, index + 1);
+   }, function(e) {
+      // The watch discards an incomplete patch and asks again next launch
+      console.log('Unable to send timetable patch message ' + index);
+   });
+}// End of sendMessages function
+
+function sendTimetablePatch(watchVersion, checksums, rejectedVersion)
+{
+   var request = new XMLHttpRequest();
+   request.responseType = 'arraybuffer';
+
+   request.onload = function() {
+      if (request.status !== 200)
+      {
+         console.log('Unable to fetch watch timetable: ' + request.status);
+         return;
+      }// End of if
+
+      try
+      {
+         var watchTimetable = parseWatchTimetable(request.response);
+
+         if (watchTimetable.version <= watchVersion) return;
+
+         // The watch has no room for this patch, so don't resend it every launch
+         if (watchTimetable.version === rejectedVersion)
+         {
+            console.log('Watch rejected timetable version ' + rejectedVersion + ', not patching');
+            return;
+         }// End of if
+
+         var messages = timetablePatch(watchTimetable, checksums);
+         console.log('Patching watch timetable from ' + watchVersion + ' to ' + watchTimetable.version + ' in ' + messages.length + ' messages');
+
+         sendMessages(messages, 0);
+      }// End of try
+      catch (e)
+      {
+         console.log('Invalid watch timetable: ' + e);
+      }// End of catch
+   };
+   request.onerror = function() {
+      console.log('Unable to fetch watch timetable');
+   };
+
+   request.open('GET', WATCH_TIMETABLE_URL);
+   request.send();
+}// End of sendTimetablePatch function
+
+Pebble.addEventListener('appmessage', function(e) {
+   if (e.payload.stop_id !== undefined)
+   {
+      sendDepartures(e.payload.stop_id, readUint16Array(e.payload.route_filter));
+   }// End of if
+   else if (e.payload.trip_from !== undefined)
+   {
+      sendTrip(e.payload.trip_from, e.payload.trip_to);
+   }// End of else if
+   else if (e.payload.timetable_version !== undefined)
+   {
+      sendTimetablePatch(e.payload.timetable_version, readUint16Array(e.payload.timetable_checksums), e.payload.timetable_rejected);
+   }// End of else if
+});
+
+// Lets tools/csa_bench.js run the planner under node
+if (typeof module !== 'undefined')
+{
+   module.exports = {
+      parseTimetable: parseTimetable,
+      planTrip: planTrip,
+      selectDepartures: selectDepartures,
+      parseWatchTimetable: parseWatchTimetable,
+      timetablePatch: timetablePatch
+   };
+}// End of if
@@ -33,6 +33,9 @@
 #define debug(fmt, ...) app_log(APP_LOG_LEVEL_DEBUG, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define verbose(fmt, ...) app_log(APP_LOG_LEVEL_DEBUG_VERBOSE, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 
+// Picked up by tools/size_report.py to find the peak heap usage of a run
+#define heap_usage(label) debug("Heap used (%s): %d bytes", label, (int)heap_bytes_used())
+
 
 
 #endif
\ No newline at end of file
@@ -27,11 +27,12 @@
 #include "main_menu.h"
 #include "stop_selection.h"
 #include "stop_details.h"
+#include "trip_plan.h"
 
 #include "log.h"
 
 #define MENU_SECTIONS 2
-#define MENU_ITEMS_SECTION_1 1
+#define MENU_ITEMS_SECTION_1 2
 #define MENU_ITEMS_SECTION_2 2
 
 struct main_menu
@@ -39,6 +40,7 @@ struct main_menu
    Window *window;
    
    SimpleMenuLayer *simple_menu_layer;
+   MenuIndex selected;
    
    SimpleMenuSection sections[MENU_SECTIONS];
    SimpleMenuItem items1[MENU_ITEMS_SECTION_1];
@@ -46,8 +48,29 @@ struct main_menu
    
    StopSelection ss;
    StopDetails sd;
+   
+   int trip_from;
+   TripPlan tp;
 } __attribute__((aligned(1)));
 
+// Selects the remembered row, unless the menu changed since it was saved
+static void main_menu_apply_selected(MainMenu mm)
+{
+   if (!mm->simple_menu_layer || mm->selected.section >= MENU_SECTIONS || mm->selected.row >= mm->sections[mm->selected.section].num_items) return;
+   
+   menu_layer_set_selected_index(simple_menu_layer_get_menu_layer(mm->simple_menu_layer), mm->selected, MenuRowAlignCenter, false);
+}// End of main_menu_apply_selected method
+
+static void stop_selection_cancelled(void *context)
+{
+   MainMenu mm = (MainMenu)context;
+   
+   info("Stop selection cancelled");
+   
+   stop_selection_destroy(mm->ss);
+   mm->ss = NULL;
+}// End of stop_selection_cancelled method
+
 static void show_stop_schedule(int stop_id, void *context)
 {
    MainMenu mm = (MainMenu)context;
@@ -57,9 +80,7 @@ static void show_stop_schedule(int stop_id, void *context)
    stop_selection_destroy(mm->ss);
    mm->ss = NULL;
    
-   if (mm->sd) stop_details_destroy(mm->sd);
-   mm->sd = stop_details_create(stop_id);
-   stop_details_show(mm->sd);
+   main_menu_show_stop_details(mm, stop_id, true);
 }// End of show_stop_schedule method
 
 static void stop_schedule_selected(int index, void *context)
@@ -68,10 +89,45 @@ static void stop_schedule_selected(int index, void *context)
    
    info("Showing 'stop_selection' to get a stop id");
    
-   mm->ss = stop_selection_create(show_stop_schedule, NULL, mm);
+   mm->ss = stop_selection_create(show_stop_schedule, stop_selection_cancelled, mm);
    stop_selection_show(mm->ss);
 }// End of show_stop_schedule method
 
+static void show_trip_plan(int stop_id, void *context)
+{
+   MainMenu mm = (MainMenu)context;
+   
+   info("Trip destination selected: %d", stop_id);
+   
+   stop_selection_destroy(mm->ss);
+   mm->ss = NULL;
+   
+   main_menu_show_trip_plan(mm, mm->trip_from, stop_id, true);
+}// End of show_trip_plan method
+
+static void trip_origin_selected(int stop_id, void *context)
+{
+   MainMenu mm = (MainMenu)context;
+   
+   info("Trip origin selected: %d", stop_id);
+   
+   stop_selection_destroy(mm->ss);
+   
+   mm->trip_from = stop_id;
+   mm->ss = stop_selection_create(show_trip_plan, stop_selection_cancelled, mm);
+   stop_selection_show(mm->ss);
+}// End of trip_origin_selected method
+
+static void trip_planner_selected(int index, void *context)
+{
+   MainMenu mm = (MainMenu)context;
+   
+   info("Showing 'stop_selection' to get the trip origin");
+   
+   mm->ss = stop_selection_create(trip_origin_selected, stop_selection_cancelled, mm);
+   stop_selection_show(mm->ss);
+}// End of trip_planner_selected method
+
 static void main_menu_handle_window_load(Window *window)
 {
    MainMenu mm = (MainMenu)window_get_user_data(window);
@@ -96,6 +152,11 @@ static void main_menu_handle_window_load(Window *window)
       .subtitle = "View schedule for a stop",
       .callback = stop_schedule_selected,
    };
+   mm->items1[item++] = (SimpleMenuItem) {
+      .title = "Trip Planner...",
+      .subtitle = "Plan a trip between stops",
+      .callback = trip_planner_selected,
+   };
    
    item = 0;
    mm->sections[section++] = (SimpleMenuSection) {
@@ -114,6 +175,10 @@ static void main_menu_handle_window_load(Window *window)
    
    mm->simple_menu_layer = simple_menu_layer_create(bounds, window, mm->sections, MENU_SECTIONS, mm);
    layer_add_child(window_layer, simple_menu_layer_get_layer(mm->simple_menu_layer));
+   
+   main_menu_apply_selected(mm);
+   
+   heap_usage("main_menu");
 }// End of main_menu_handle_window_load method
 
 static void main_menu_handle_window_unload(Window *window)
@@ -123,7 +188,10 @@ static void main_menu_handle_window_unload(Window *window)
    // Unload GUI components
    info("Destroying 'main_menu' GUI components");
    
+   mm->selected = menu_layer_get_selected_index(simple_menu_layer_get_menu_layer(mm->simple_menu_layer));
+   
    simple_menu_layer_destroy(mm->simple_menu_layer);
+   mm->simple_menu_layer = NULL;
 }// End of main_menu_handle_window_unload method
 
 MainMenu main_menu_create(void)
@@ -132,6 +200,14 @@ MainMenu main_menu_create(void)
    
    MainMenu mm = (MainMenu)malloc(sizeof(struct main_menu));
    
+   if (!mm) error("Unable to allocate memory for 'main_menu' object");
+   
+   mm->ss = NULL;
+   mm->sd = NULL;
+   mm->tp = NULL;
+   mm->simple_menu_layer = NULL;
+   mm->selected = (MenuIndex) { .section = 0, .row = 0 };
+   
    // Configure window
    mm->window = window_create();
    
@@ -152,7 +228,9 @@ void main_menu_destroy(MainMenu mm)
    info("Destroying 'main_menu' object");
    
    window_destroy(mm->window);
+   if (mm->ss) stop_selection_destroy(mm->ss);
    if (mm->sd) stop_details_destroy(mm->sd);
+   if (mm->tp) trip_plan_destroy(mm->tp);
    
    free(mm);
 }// End of main_menu_destroy method
@@ -168,3 +246,72 @@ void main_menu_hide(MainMenu mm)
    info("Hiding 'main_menu' window");
    window_stack_remove(mm->window, true);
 }// End of main_menu_hide method
+
+void main_menu_show_stop_details(MainMenu mm, int stop_id, bool animated)
+{
+   info("Showing 'stop_details' for stop: %d", stop_id);
+   
+   if (mm->sd) stop_details_destroy(mm->sd);
+   mm->sd = stop_details_create(stop_id);
+   stop_details_show(mm->sd, animated);
+}// End of main_menu_show_stop_details method
+
+void main_menu_show_trip_plan(MainMenu mm, int from_stop, int to_stop, bool animated)
+{
+   info("Showing 'trip_plan' from %d to %d", from_stop, to_stop);
+   
+   if (mm->tp) trip_plan_destroy(mm->tp);
+   mm->tp = trip_plan_create(from_stop, to_stop);
+   trip_plan_show(mm->tp, animated);
+}// End of main_menu_show_trip_plan method
+
+void main_menu_get_nav_state(MainMenu mm, NavState *state)
+{
+   memset(state, 0, sizeof(NavState));
+   
+   MenuIndex selected = mm->simple_menu_layer ?
+      menu_layer_get_selected_index(simple_menu_layer_get_menu_layer(mm->simple_menu_layer)) : mm->selected;
+   
+   // Only the screen on top matters; anything popped before exit is forgotten
+   if (mm->sd && stop_details_is_on_stack(mm->sd))
+   {
+      state->screen = NAV_SCREEN_STOP_DETAILS;
+      state->stop_id = stop_details_get_stop_id(mm->sd);
+      selected = stop_details_get_selected(mm->sd);
+   }
+   else if (mm->tp && trip_plan_is_on_stack(mm->tp))
+   {
+      state->screen = NAV_SCREEN_TRIP_PLAN;
+      state->trip_from = trip_plan_get_from_stop(mm->tp);
+      state->trip_to = trip_plan_get_to_stop(mm->tp);
+   }
+   else
+   {
+      state->screen = NAV_SCREEN_MAIN_MENU;
+   }// End of if
+   
+   state->section = selected.section;
+   state->row = selected.row;
+   state->saved = time(NULL);
+}// End of main_menu_get_nav_state method
+
+void main_menu_restore(MainMenu mm, const NavState *state)
+{
+   MenuIndex selected = { .section = state->section, .row = state->row };
+   
+   switch (state->screen)
+   {
+      case NAV_SCREEN_STOP_DETAILS:
+         // Pushed without animation so the first frame already shows the stop
+         main_menu_show_stop_details(mm, state->stop_id, false);
+         stop_details_set_selected(mm->sd, selected);
+         break;
+      case NAV_SCREEN_TRIP_PLAN:
+         main_menu_show_trip_plan(mm, state->trip_from, state->trip_to, false);
+         break;
+      default:
+         mm->selected = selected;
+         main_menu_apply_selected(mm);
+         break;
+   }// End of switch
+}// End of main_menu_restore method
@@ -24,6 +24,8 @@
 
 #include <pebble.h>
 
+#include "nav_state.h"
+
 #ifndef _main_menu_h
 #define _main_menu_h
 
@@ -36,4 +38,10 @@ void main_menu_destroy(MainMenu mm);
 void main_menu_show(MainMenu mm);
 void main_menu_hide(MainMenu mm);
 
+void main_menu_show_stop_details(MainMenu mm, int stop_id, bool animated);
+void main_menu_show_trip_plan(MainMenu mm, int from_stop, int to_stop, bool animated);
+
+void main_menu_get_nav_state(MainMenu mm, NavState *state);
+void main_menu_restore(MainMenu mm, const NavState *state);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "message.h"
+
+#include "log.h"
+
+#define INBOX_SIZE 256
+#define OUTBOX_SIZE 256
+#define MAX_HANDLERS 8
+
+static struct
+{
+   uint32_t key;
+   MessageHandler handler;
+} s_handlers[MAX_HANDLERS];
+static int s_num_handlers = 0;
+
+static struct
+{
+   uint32_t key;
+   MessageFailedHandler handler;
+} s_failed_handlers[MAX_HANDLERS];
+static int s_num_failed_handlers = 0;
+
+static void message_inbox_received(DictionaryIterator *iter, void *context)
+{
+   for (int x = 0; x < s_num_handlers; ++x)
+   {
+      if (dict_find(iter, s_handlers[x].key))
+      {
+         s_handlers[x].handler(iter);
+         return;
+      }// End of if
+   }// End of for
+   
+   warn("Ignoring message without a handler");
+}// End of message_inbox_received method
+
+static void message_inbox_dropped(AppMessageResult reason, void *context)
+{
+   warn("Dropped incoming message: %d", reason);
+}// End of message_inbox_dropped method
+
+static void message_outbox_failed(DictionaryIterator *iter, AppMessageResult reason, void *context)
+{
+   warn("Unable to send message: %d", reason);
+   
+   for (int x = 0; x < s_num_failed_handlers; ++x)
+   {
+      if (dict_find(iter, s_failed_handlers[x].key))
+      {
+         s_failed_handlers[x].handler(iter, reason);
+         return;
+      }// End of if
+   }// End of for
+}// End of message_outbox_failed method
+
+void message_init(void)
+{
+   info("Opening app message channel");
+   
+   app_message_register_inbox_received(message_inbox_received);
+   app_message_register_inbox_dropped(message_inbox_dropped);
+   app_message_register_outbox_failed(message_outbox_failed);
+   
+   AppMessageResult result = app_message_open(INBOX_SIZE, OUTBOX_SIZE);
+   if (result != APP_MSG_OK) error("Unable to open app message channel: %d", result);
+}// End of message_init method
+
+void message_deinit(void)
+{
+   info("Closing app message channel");
+   
+   app_message_deregister_callbacks();
+   s_num_handlers = 0;
+   s_num_failed_handlers = 0;
+}// End of message_deinit method
+
+void message_register(uint32_t key, MessageHandler handler)
+{
+   if (s_num_handlers >= MAX_HANDLERS)
+   {
+      error("Too many message handlers, not registering key: %d", (int)key);
+      return;
+   }// End of if
+   
+   s_handlers[s_num_handlers].key = key;
+   s_handlers[s_num_handlers].handler = handler;
+   ++s_num_handlers;
+}// End of message_register method
+
+void message_register_failed(uint32_t key, MessageFailedHandler handler)
+{
+   if (s_num_failed_handlers >= MAX_HANDLERS)
+   {
+      error("Too many message failed handlers, not registering key: %d", (int)key);
+      return;
+   }// End of if
+   
+   s_failed_handlers[s_num_failed_handlers].key = key;
+   s_failed_handlers[s_num_failed_handlers].handler = handler;
+   ++s_num_failed_handlers;
+}// End of message_register_failed method
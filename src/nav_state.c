@@ -0,0 +1,79 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "nav_state.h"
+#include "app_keys.h"
+
+#include "log.h"
+
+static time_t s_launch_seconds;
+static uint16_t s_launch_ms;
+static bool s_ready = true;
+
+bool nav_state_load(NavState *state)
+{
+   if (!persist_exists(PERSIST_KEY_NAV_STATE)) return false;
+   
+   if (persist_read_data(PERSIST_KEY_NAV_STATE, state, sizeof(NavState)) != sizeof(NavState)) return false;
+   
+   int age = time(NULL) - (time_t)state->saved;
+   
+   if (age < 0 || age > NAV_STATE_MAX_AGE)
+   {
+      info("Ignoring navigation state saved %d seconds ago", age);
+      return false;
+   }// End of if
+   
+   info("Loaded navigation state: screen %d, stop %d, saved %d seconds ago", state->screen, state->stop_id, age);
+   
+   return true;
+}// End of nav_state_load method
+
+void nav_state_save(const NavState *state)
+{
+   info("Saving navigation state: screen %d, stop %d", state->screen, state->stop_id);
+   
+   int bytes = persist_write_data(PERSIST_KEY_NAV_STATE, state, sizeof(NavState));
+   if (bytes < 0) error("Unable to save navigation state: %d", bytes);
+}// End of nav_state_save method
+
+void nav_state_mark_launch(void)
+{
+   time_ms(&s_launch_seconds, &s_launch_ms);
+   s_ready = false;
+}// End of nav_state_mark_launch method
+
+void nav_state_mark_ready(const char *screen)
+{
+   if (s_ready) return;
+   s_ready = true;
+   
+   time_t seconds;
+   uint16_t ms;
+   time_ms(&seconds, &ms);
+   
+   info("Launch to useful '%s' in %d ms", screen, (int)((seconds - s_launch_seconds) * 1000 + ms - s_launch_ms));
+}// End of nav_state_mark_ready method
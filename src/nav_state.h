@@ -0,0 +1,60 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#ifndef _nav_state_h
+#define _nav_state_h
+
+// Older states are forgotten and the app opens on the main menu
+#define NAV_STATE_MAX_AGE (6 * 60 * 60)
+
+typedef enum
+{
+   NAV_SCREEN_MAIN_MENU = 0,
+   NAV_SCREEN_STOP_DETAILS,
+   NAV_SCREEN_TRIP_PLAN
+} NavScreen;
+
+// Snapshot of where the user was when the app exited
+typedef struct nav_state
+{
+   uint8_t screen;
+   uint8_t section;
+   uint16_t row;
+   uint16_t stop_id;
+   uint16_t trip_from;
+   uint16_t trip_to;
+   uint32_t saved;
+} __attribute__((__packed__)) NavState;
+
+// Returns false if there is no state saved within NAV_STATE_MAX_AGE
+bool nav_state_load(NavState *state);
+void nav_state_save(const NavState *state);
+
+// Logs the time from launch until a screen first shows useful data
+void nav_state_mark_launch(void);
+void nav_state_mark_ready(const char *screen);
+
+#endif
@@ -0,0 +1,193 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "prefetch.h"
+#include "departures.h"
+#include "route_filter.h"
+
+#include "log.h"
+
+#define TIMEOUT_MS 30000
+#define RETRY_MS 5000
+#define TEXT_LENGTH 32
+
+struct prefetch
+{
+   int stop_id;
+   RouteFilter rf;
+   
+   Window *window;
+   TextLayer *text_layer;
+   char text[TEXT_LENGTH];
+   
+   AppTimer *timer;
+   AppTimer *retry_timer;
+} __attribute__((aligned(1)));
+
+static void prefetch_finish(Prefetch pf)
+{
+   info("Prefetch of stop %d finished", pf->stop_id);
+   
+   departures_cancel(pf);
+   
+   if (pf->timer) app_timer_cancel(pf->timer);
+   if (pf->retry_timer) app_timer_cancel(pf->retry_timer);
+   pf->timer = NULL;
+   pf->retry_timer = NULL;
+   
+   // Leaving the window stack empty exits the app
+   window_stack_pop_all(false);
+}// End of prefetch_finish method
+
+static void prefetch_timed_out(void *context)
+{
+   Prefetch pf = (Prefetch)context;
+   
+   warn("Timed out prefetching stop: %d", pf->stop_id);
+   
+   pf->timer = NULL;
+   prefetch_finish(pf);
+}// End of prefetch_timed_out method
+
+static void prefetch_departures_received(int stop_id, const Departure *departures, int num_departures, const uint16_t *routes, int num_routes, void *context)
+{
+   // departures.c has already cached them
+   prefetch_finish((Prefetch)context);
+}// End of prefetch_departures_received method
+
+static void prefetch_request(Prefetch pf);
+
+static void prefetch_retry(void *context)
+{
+   Prefetch pf = (Prefetch)context;
+   
+   pf->retry_timer = NULL;
+   prefetch_request(pf);
+}// End of prefetch_retry method
+
+static void prefetch_departures_failed(int stop_id, void *context)
+{
+   Prefetch pf = (Prefetch)context;
+   
+   warn("Prefetch request for stop %d failed, retrying", stop_id);
+   pf->retry_timer = app_timer_register(RETRY_MS, prefetch_retry, pf);
+}// End of prefetch_departures_failed method
+
+// PebbleKit JS may still be starting after a wakeup, so ask again whenever a
+// request can't be sent or fails, until departures arrive or the timeout fires
+static void prefetch_request(Prefetch pf)
+{
+   if (!departures_request(pf->stop_id, pf->rf, prefetch_departures_received, prefetch_departures_failed, pf))
+   {
+      warn("Unable to request departures for prefetch of stop: %d", pf->stop_id);
+      pf->retry_timer = app_timer_register(RETRY_MS, prefetch_retry, pf);
+   }// End of if
+}// End of prefetch_request method
+
+static void prefetch_handle_window_load(Window *window)
+{
+   Prefetch pf = (Prefetch)window_get_user_data(window);
+   
+   // Init GUI components
+   info("Initializing 'prefetch' GUI components");
+   
+   Layer *window_layer = window_get_root_layer(window);
+   GRect bounds = layer_get_frame(window_layer);
+   
+   snprintf(pf->text, TEXT_LENGTH, "Updating stop %d...", pf->stop_id);
+   
+   pf->text_layer = text_layer_create((GRect) {
+      .origin = { 0, bounds.size.h / 2 - 15 },
+      .size = { bounds.size.w, 30 }
+   });
+   text_layer_set_text(pf->text_layer, pf->text);
+   text_layer_set_text_alignment(pf->text_layer, GTextAlignmentCenter);
+   layer_add_child(window_layer, text_layer_get_layer(pf->text_layer));
+   
+   pf->timer = app_timer_register(TIMEOUT_MS, prefetch_timed_out, pf);
+   prefetch_request(pf);
+   
+   heap_usage("prefetch");
+}// End of prefetch_handle_window_load method
+
+static void prefetch_handle_window_unload(Window *window)
+{
+   Prefetch pf = (Prefetch)window_get_user_data(window);
+   
+   // Unload GUI components
+   info("Destroying 'prefetch' GUI components");
+   
+   text_layer_destroy(pf->text_layer);
+   pf->text_layer = NULL;
+}// End of prefetch_handle_window_unload method
+
+Prefetch prefetch_create(int stop_id)
+{
+   info("Creating 'prefetch' object");
+   
+   Prefetch pf = (Prefetch)malloc(sizeof(struct prefetch));
+   
+   if (!pf) error("Unable to allocate memory for 'prefetch' object");
+   
+   pf->stop_id = stop_id;
+   pf->rf = route_filter_load(stop_id);
+   pf->text_layer = NULL;
+   pf->timer = NULL;
+   pf->retry_timer = NULL;
+   
+   // Configure window
+   pf->window = window_create();
+   
+   if (!(pf->window)) error("Unable to allocate memory for 'window' object");
+   
+   window_set_fullscreen(pf->window, false);
+   window_set_window_handlers(pf->window, (WindowHandlers) {
+      .load = prefetch_handle_window_load,
+      .unload = prefetch_handle_window_unload
+   });
+   window_set_user_data(pf->window, pf);
+   
+   return pf;
+}// End of prefetch_create method
+
+void prefetch_destroy(Prefetch pf)
+{
+   info("Destroying 'prefetch' object");
+   
+   departures_cancel(pf);
+   if (pf->timer) app_timer_cancel(pf->timer);
+   if (pf->retry_timer) app_timer_cancel(pf->retry_timer);
+   
+   window_destroy(pf->window);
+   route_filter_destroy(pf->rf);
+   free(pf);
+}// End of prefetch_destroy method
+
+void prefetch_show(Prefetch pf)
+{
+   info("Showing 'prefetch' window");
+   window_stack_push(pf->window, false);
+}// End of prefetch_show method
@@ -0,0 +1,133 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "route_filter.h"
+#include "app_keys.h"
+
+#include "log.h"
+
+struct route_filter
+{
+   int stop_id;
+   
+   int num_routes;
+   uint16_t routes[ROUTE_FILTER_MAX_ROUTES];
+} __attribute__((aligned(1)));
+
+static int route_filter_index_of(RouteFilter rf, int route)
+{
+   for (int x = 0; x < rf->num_routes; ++x)
+   {
+      if (rf->routes[x] == route) return x;
+   }// End of for
+   
+   return -1;
+}// End of route_filter_index_of method
+
+RouteFilter route_filter_load(int stop_id)
+{
+   info("Loading 'route_filter' for stop: %d", stop_id);
+   
+   RouteFilter rf = (RouteFilter)malloc(sizeof(struct route_filter));
+   
+   if (!rf)
+   {
+      error("Unable to allocate memory for 'route_filter' object");
+      return NULL;
+   }// End of if
+   
+   rf->stop_id = stop_id;
+   rf->num_routes = 0;
+   
+   uint32_t key = PERSIST_KEY_ROUTE_FILTER + stop_id;
+   
+   // Filters used to be allow-lists, which can't be read as hidden routes
+   if (persist_exists(PERSIST_KEY_ROUTE_ALLOW_LIST + stop_id)) persist_delete(PERSIST_KEY_ROUTE_ALLOW_LIST + stop_id);
+   
+   if (persist_exists(key))
+   {
+      int bytes = persist_read_data(key, rf->routes, sizeof(rf->routes));
+      rf->num_routes = (bytes > 0) ? bytes / sizeof(rf->routes[0]) : 0;
+   }// End of if
+   
+   debug("Route filter for stop %d has %d routes", stop_id, rf->num_routes);
+   
+   return rf;
+}// End of route_filter_load method
+
+void route_filter_save(RouteFilter rf)
+{
+   info("Saving 'route_filter' for stop: %d", rf->stop_id);
+   
+   uint32_t key = PERSIST_KEY_ROUTE_FILTER + rf->stop_id;
+   
+   if (rf->num_routes == 0)
+   {
+      persist_delete(key);
+      return;
+   }// End of if
+   
+   int bytes = persist_write_data(key, rf->routes, rf->num_routes * sizeof(rf->routes[0]));
+   if (bytes < 0) error("Unable to save route filter for stop %d: %d", rf->stop_id, bytes);
+}// End of route_filter_save method
+
+void route_filter_destroy(RouteFilter rf)
+{
+   info("Destroying 'route_filter' object");
+   free(rf);
+}// End of route_filter_destroy method
+
+bool route_filter_allows(RouteFilter rf, int route)
+{
+   return route_filter_index_of(rf, route) < 0;
+}// End of route_filter_allows method
+
+void route_filter_hide(RouteFilter rf, int route)
+{
+   if (route_filter_index_of(rf, route) >= 0) return;
+   
+   if (rf->num_routes >= ROUTE_FILTER_MAX_ROUTES)
+   {
+      warn("Route filter is full, not hiding route: %d", route);
+      return;
+   }// End of if
+   
+   rf->routes[rf->num_routes++] = route;
+}// End of route_filter_hide method
+
+void route_filter_show(RouteFilter rf, int route)
+{
+   int index = route_filter_index_of(rf, route);
+   if (index < 0) return;
+   
+   rf->routes[index] = rf->routes[--rf->num_routes];
+}// End of route_filter_show method
+
+const uint16_t *route_filter_get_routes(RouteFilter rf, int *num_routes)
+{
+   *num_routes = rf->num_routes;
+   return rf->routes;
+}// End of route_filter_get_routes method
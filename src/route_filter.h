@@ -0,0 +1,48 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#ifndef _route_filter_h
+#define _route_filter_h
+
+#define ROUTE_FILTER_MAX_ROUTES 16
+
+// The routes a user has hidden at a stop. Routes the user never hid are
+// always shown, including ones not running when the filter was edited.
+struct route_filter;
+typedef struct route_filter * RouteFilter;
+
+RouteFilter route_filter_load(int stop_id);
+void route_filter_save(RouteFilter rf);
+void route_filter_destroy(RouteFilter rf);
+
+bool route_filter_allows(RouteFilter rf, int route);
+
+void route_filter_hide(RouteFilter rf, int route);
+void route_filter_show(RouteFilter rf, int route);
+
+const uint16_t *route_filter_get_routes(RouteFilter rf, int *num_routes);
+
+#endif
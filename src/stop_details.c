@@ -25,26 +25,389 @@
 #include <pebble.h>
 
 #include "stop_details.h"
+#include "departures.h"
+#include "departure_cache.h"
+#include "route_filter.h"
+#include "commute.h"
+#include "commute_editor.h"
+#include "timetable.h"
+#include "nav_state.h"
 
 #include "log.h"
 
-#define MENU_SECTIONS 2
+#define MENU_SECTIONS 4
 #define MENU_ITEMS_SECTION_1 1
-#define MENU_ITEMS_SECTION_2 5
+#define MENU_ITEMS_SECTION_2 DEPARTURES_MAX
+#define MENU_ITEMS_SECTION_3 DEPARTURES_MAX_ROUTES
+#define MENU_ITEMS_SECTION_4 2
+
+#define TITLE_LENGTH 32
+#define SUBTITLE_LENGTH 24
+#define ROUTE_TITLE_LENGTH 12
+#define COMMUTE_LENGTH 24
+#define SECTION_TITLE_LENGTH 24
 
 struct stop_details
 {
    int stop_id;
+   char stop_id_text[5];
+   
+   RouteFilter rf;
    
    Window *window;
    
    SimpleMenuLayer *simple_menu_layer;
+   MenuIndex selected;
    
    SimpleMenuSection sections[MENU_SECTIONS];
    SimpleMenuItem items1[MENU_ITEMS_SECTION_1];
    SimpleMenuItem items2[MENU_ITEMS_SECTION_2];
+   SimpleMenuItem items3[MENU_ITEMS_SECTION_3];
+   SimpleMenuItem items4[MENU_ITEMS_SECTION_4];
+   
+   const char *status;
+   
+   Departure departures[DEPARTURES_MAX];
+   int num_departures;
+   time_t fetched; // When the departures were fetched, 0 if never
+   bool scheduled;
+   char departures_title[SECTION_TITLE_LENGTH];
+   char departure_titles[DEPARTURES_MAX][TITLE_LENGTH];
+   char departure_subtitles[DEPARTURES_MAX][SUBTITLE_LENGTH];
+   
+   uint16_t routes[DEPARTURES_MAX_ROUTES];
+   int num_routes;
+   char route_titles[DEPARTURES_MAX_ROUTES][ROUTE_TITLE_LENGTH];
+   
+   char commute_text[COMMUTE_LENGTH];
+   CommuteEditor ce;
 } __attribute__((aligned(1)));
 
+static void stop_details_refresh(StopDetails sd);
+
+static void stop_details_departure_selected(int index, void *context)
+{
+   StopDetails sd = (StopDetails)context;
+   
+   info("Refreshing departures for stop: %d", sd->stop_id);
+   stop_details_refresh(sd);
+}// End of stop_details_departure_selected method
+
+// True if any departure hasn't left yet, allowing a minute for a late bus
+static bool stop_details_has_upcoming(StopDetails sd, time_t now)
+{
+   for (int x = 0; x < sd->num_departures; ++x)
+   {
+      if ((time_t)sd->departures[x].time >= now - 60) return true;
+   }// End of for
+   
+   return false;
+}// End of stop_details_has_upcoming method
+
+static void stop_details_update_departures(StopDetails sd)
+{
+   debug("Updating 'stop_details' departures");
+   
+   time_t now = time(NULL);
+   int item = 0;
+   
+   // Saved departures say how old they are so they don't pass for live ones
+   int age = (now - sd->fetched) / 60;
+   if (sd->scheduled) snprintf(sd->departures_title, SECTION_TITLE_LENGTH, "Scheduled Buses");
+   else if (!sd->fetched || age < 1) snprintf(sd->departures_title, SECTION_TITLE_LENGTH, "Next Buses");
+   else if (age < 90) snprintf(sd->departures_title, SECTION_TITLE_LENGTH, "Updated %d min ago", age);
+   else snprintf(sd->departures_title, SECTION_TITLE_LENGTH, "Updated %d h ago", age / 60);
+   
+   sd->sections[1].title = sd->departures_title;
+   
+   for (int x = 0; x < sd->num_departures; ++x)
+   {
+      Departure *departure = &sd->departures[x];
+      
+      // Cached departures may have already left
+      if ((time_t)departure->time < now - 60) continue;
+      
+      snprintf(sd->departure_titles[item], TITLE_LENGTH, "%d %s", departure->route, departure->headsign);
+      
+      time_t departure_time = departure->time;
+      strftime(sd->departure_subtitles[item], SUBTITLE_LENGTH, clock_is_24h_style() ? "%H:%M" : "%I:%M %p", localtime(&departure_time));
+      
+      int minutes = (departure_time - now) / 60;
+      if (minutes > 0)
+      {
+         int length = strlen(sd->departure_subtitles[item]);
+         snprintf(sd->departure_subtitles[item] + length, SUBTITLE_LENGTH - length, " (%d min)", minutes);
+      }// End of if
+      
+      sd->items2[item] = (SimpleMenuItem) {
+         .title = sd->departure_titles[item],
+         .subtitle = sd->departure_subtitles[item],
+         .callback = stop_details_departure_selected
+      };
+      ++item;
+   }// End of for
+   
+   if (item == 0)
+   {
+      // Selecting any departure row asks for them again
+      sd->items2[item++] = (SimpleMenuItem) {
+         .title = "--",
+         .subtitle = sd->status,
+         .callback = stop_details_departure_selected
+      };
+   }// End of if
+   
+   sd->sections[1].num_items = item;
+}// End of stop_details_update_departures method
+
+static void stop_details_route_selected(int index, void *context);
+
+static void stop_details_update_routes(StopDetails sd)
+{
+   debug("Updating 'stop_details' routes");
+   
+   if (sd->num_routes == 0)
+   {
+      sd->sections[2].num_items = 1;
+      sd->items3[0] = (SimpleMenuItem) {
+         .title = "--",
+         .subtitle = sd->status
+      };
+      return;
+   }// End of if
+   
+   for (int x = 0; x < sd->num_routes; ++x)
+   {
+      snprintf(sd->route_titles[x], ROUTE_TITLE_LENGTH, "Route %d", sd->routes[x]);
+      
+      sd->items3[x] = (SimpleMenuItem) {
+         .title = sd->route_titles[x],
+         .subtitle = route_filter_allows(sd->rf, sd->routes[x]) ? "Shown" : "Hidden",
+         .callback = stop_details_route_selected
+      };
+   }// End of for
+   
+   sd->sections[2].num_items = sd->num_routes;
+}// End of stop_details_update_routes method
+
+static void stop_details_commute_selected(int index, void *context);
+
+// New commutes are offered at the current time, rounded down to five
+// minutes, on weekdays or weekends to match today
+static CommuteWindow stop_details_commute_now(StopDetails sd)
+{
+   time_t now = time(NULL);
+   struct tm *tm = localtime(&now);
+   
+   return (CommuteWindow) {
+      .stop_id = sd->stop_id,
+      .hour = tm->tm_hour,
+      .minute = tm->tm_min - tm->tm_min % 5,
+      .days = (tm->tm_wday == 0 || tm->tm_wday == 6) ? COMMUTE_DAYS_WEEKENDS : COMMUTE_DAYS_WEEKDAYS
+   };
+}// End of stop_details_commute_now method
+
+static void stop_details_update_commute(StopDetails sd)
+{
+   debug("Updating 'stop_details' commute");
+   
+   CommuteWindow windows[COMMUTE_MAX_WINDOWS];
+   int num_windows = commute_load(windows);
+   int index = commute_find(windows, num_windows, sd->stop_id);
+   
+   CommuteWindow window;
+   if (index >= 0)
+   {
+      window = windows[index];
+   }// End of if
+   else
+   {
+      window = stop_details_commute_now(sd);
+   }// End of else
+   
+   const char *days = "Daily";
+   if (window.days == COMMUTE_DAYS_WEEKDAYS) days = "Weekdays";
+   else if (window.days == COMMUTE_DAYS_WEEKENDS) days = "Weekends";
+   
+   snprintf(sd->commute_text, COMMUTE_LENGTH, "%s at %d:%02d", days, window.hour, window.minute);
+   
+   sd->items4[0] = (SimpleMenuItem) {
+      .title = (index >= 0) ? "Edit commute..." : "Add commute...",
+      .subtitle = sd->commute_text,
+      .callback = stop_details_commute_selected
+   };
+   sd->items4[1] = (SimpleMenuItem) {
+      .title = "Remove commute",
+      .callback = stop_details_commute_selected
+   };
+   
+   sd->sections[3].num_items = (index >= 0) ? 2 : 1;
+}// End of stop_details_update_commute method
+
+static void stop_details_reload(StopDetails sd)
+{
+   stop_details_update_departures(sd);
+   stop_details_update_routes(sd);
+   stop_details_update_commute(sd);
+   
+   if (sd->simple_menu_layer) menu_layer_reload_data(simple_menu_layer_get_menu_layer(sd->simple_menu_layer));
+}// End of stop_details_reload method
+
+static void stop_details_route_selected(int index, void *context)
+{
+   StopDetails sd = (StopDetails)context;
+   int route = sd->routes[index];
+   
+   info("Toggling route %d at stop %d", route, sd->stop_id);
+   
+   if (route_filter_allows(sd->rf, route))
+   {
+      int num_shown = 0;
+      for (int x = 0; x < sd->num_routes; ++x)
+      {
+         if (route_filter_allows(sd->rf, sd->routes[x])) ++num_shown;
+      }// End of for
+      
+      if (num_shown == 1)
+      {
+         info("Not hiding the only shown route: %d", route);
+         return;
+      }// End of if
+      
+      route_filter_hide(sd->rf, route);
+   }// End of if
+   else
+   {
+      route_filter_show(sd->rf, route);
+   }// End of else
+   
+   route_filter_save(sd->rf);
+   stop_details_refresh(sd);
+}// End of stop_details_route_selected method
+
+static void stop_details_commute_edited(CommuteWindow window, void *context)
+{
+   StopDetails sd = (StopDetails)context;
+   
+   commute_editor_destroy(sd->ce);
+   sd->ce = NULL;
+   
+   CommuteWindow windows[COMMUTE_MAX_WINDOWS];
+   int num_windows = commute_load(windows);
+   int existing = commute_find(windows, num_windows, sd->stop_id);
+   
+   if (existing < 0 && num_windows >= COMMUTE_MAX_WINDOWS)
+   {
+      warn("Already have %d commutes, not adding stop: %d", num_windows, sd->stop_id);
+      return;
+   }// End of if
+   
+   info("Saving commute for stop %d at %d:%02d", sd->stop_id, window.hour, window.minute);
+   
+   windows[(existing >= 0) ? existing : num_windows++] = window;
+   
+   commute_save(windows, num_windows);
+   commute_schedule();
+   
+   stop_details_reload(sd);
+}// End of stop_details_commute_edited method
+
+static void stop_details_commute_cancelled(void *context)
+{
+   StopDetails sd = (StopDetails)context;
+   
+   commute_editor_destroy(sd->ce);
+   sd->ce = NULL;
+}// End of stop_details_commute_cancelled method
+
+static void stop_details_commute_selected(int index, void *context)
+{
+   StopDetails sd = (StopDetails)context;
+   
+   CommuteWindow windows[COMMUTE_MAX_WINDOWS];
+   int num_windows = commute_load(windows);
+   int existing = commute_find(windows, num_windows, sd->stop_id);
+   
+   if (index == 1 && existing >= 0)
+   {
+      info("Removing commute for stop: %d", sd->stop_id);
+      windows[existing] = windows[--num_windows];
+      
+      commute_save(windows, num_windows);
+      commute_schedule();
+      
+      stop_details_reload(sd);
+      return;
+   }// End of if
+   
+   if (existing < 0 && num_windows >= COMMUTE_MAX_WINDOWS)
+   {
+      warn("Already have %d commutes, not adding stop: %d", num_windows, sd->stop_id);
+      return;
+   }// End of if
+   
+   info("Showing 'commute_editor' for stop: %d", sd->stop_id);
+   
+   if (sd->ce) commute_editor_destroy(sd->ce);
+   sd->ce = commute_editor_create((existing >= 0) ? windows[existing] : stop_details_commute_now(sd), stop_details_commute_edited, stop_details_commute_cancelled, sd);
+   commute_editor_show(sd->ce);
+}// End of stop_details_commute_selected method
+
+static void stop_details_departures_received(int stop_id, const Departure *departures, int num_departures, const uint16_t *routes, int num_routes, void *context)
+{
+   StopDetails sd = (StopDetails)context;
+   
+   memcpy(sd->departures, departures, num_departures * sizeof(Departure));
+   sd->num_departures = num_departures;
+   
+   memcpy(sd->routes, routes, num_routes * sizeof(uint16_t));
+   sd->num_routes = num_routes;
+   
+   sd->fetched = time(NULL);
+   sd->scheduled = false;
+   
+   sd->status = "No upcoming buses";
+   
+   stop_details_reload(sd);
+   
+   nav_state_mark_ready("stop_details");
+}// End of stop_details_departures_received method
+
+// Keeps cached departures that haven't left, otherwise shows the bundled schedule
+static void stop_details_show_offline(StopDetails sd)
+{
+   sd->status = "Unable to connect";
+   
+   time_t now = time(NULL);
+   
+   if (!stop_details_has_upcoming(sd, now))
+   {
+      sd->num_departures = timetable_next_departures(sd->stop_id, now, sd->rf, sd->departures, DEPARTURES_MAX);
+      sd->scheduled = true;
+   }// End of if
+   
+   stop_details_reload(sd);
+}// End of stop_details_show_offline method
+
+static void stop_details_departures_failed(int stop_id, void *context)
+{
+   stop_details_show_offline((StopDetails)context);
+}// End of stop_details_departures_failed method
+
+static void stop_details_refresh(StopDetails sd)
+{
+   // Cached departures stay on screen until the reply replaces them
+   if (!departures_request(sd->stop_id, sd->rf, stop_details_departures_received, stop_details_departures_failed, sd))
+   {
+      stop_details_show_offline(sd);
+      return;
+   }// End of if
+   
+   sd->status = "Loading...";
+   
+   stop_details_reload(sd);
+}// End of stop_details_refresh method
+
 static void stop_details_handle_window_load(Window *window)
 {
    StopDetails sd = (StopDetails)window_get_user_data(window);
@@ -65,43 +428,44 @@ static void stop_details_handle_window_load(Window *window)
      .num_items = MENU_ITEMS_SECTION_1
    };
    
-   static char *stop_id = "####";
-   snprintf(stop_id, sizeof(stop_id) + 1, "%d", sd->stop_id);
+   snprintf(sd->stop_id_text, sizeof(sd->stop_id_text), "%d", sd->stop_id);
    
    sd->items1[item++] = (SimpleMenuItem) {
       .title = "Stop ID",
-      .subtitle = stop_id
+      .subtitle = sd->stop_id_text
    };
    
-   item = 0;
    sd->sections[section++] = (SimpleMenuSection) {
-     .title = "Next Buses",
+     .title = sd->departures_title,
      .items = sd->items2,
      .num_items = MENU_ITEMS_SECTION_2
    };
-   sd->items2[item++] = (SimpleMenuItem) {
-      .title = "--",
-      .subtitle = "--" 
-   };
-   sd->items2[item++] = (SimpleMenuItem) {
-      .title = "--",
-      .subtitle = "--" 
-   };
-   sd->items2[item++] = (SimpleMenuItem) {
-      .title = "--",
-      .subtitle = "--" 
-   };
-   sd->items2[item++] = (SimpleMenuItem) {
-      .title = "--",
-      .subtitle = "--" 
+   
+   sd->sections[section++] = (SimpleMenuSection) {
+     .title = "Routes",
+     .items = sd->items3,
+     .num_items = MENU_ITEMS_SECTION_3
    };
-   sd->items2[item++] = (SimpleMenuItem) {
-      .title = "--",
-      .subtitle = "--" 
+   
+   sd->sections[section++] = (SimpleMenuSection) {
+     .title = "Commute",
+     .items = sd->items4,
+     .num_items = MENU_ITEMS_SECTION_4
    };
    
+   stop_details_update_departures(sd);
+   stop_details_update_routes(sd);
+   stop_details_update_commute(sd);
+   
    sd->simple_menu_layer = simple_menu_layer_create(bounds, window, sd->sections, MENU_SECTIONS, sd);
    layer_add_child(window_layer, simple_menu_layer_get_layer(sd->simple_menu_layer));
+   
+   stop_details_refresh(sd);
+   
+   // After the refresh so rows painted from the cache can be selected
+   stop_details_set_selected(sd, sd->selected);
+   
+   heap_usage("stop_details");
 }// End of stop_details_handle_window_load method
 
 static void stop_details_handle_window_unload(Window *window)
@@ -111,16 +475,41 @@ static void stop_details_handle_window_unload(Window *window)
    // Unload GUI components
    info("Destroying 'stop_details' GUI components");
    
+   departures_cancel(sd);
+   
+   sd->selected = stop_details_get_selected(sd);
+   
    simple_menu_layer_destroy(sd->simple_menu_layer);
+   sd->simple_menu_layer = NULL;
 }// End of stop_details_handle_window_unload method
 
+static void stop_details_handle_window_appear(Window *window)
+{
+   StopDetails sd = (StopDetails)window_get_user_data(window);
+   
+   // Cached departures are useful as soon as they are on screen, unless
+   // they have all left and the window only shows "--"
+   if (stop_details_has_upcoming(sd, time(NULL))) nav_state_mark_ready("stop_details");
+}// End of stop_details_handle_window_appear method
+
 StopDetails stop_details_create(int stop_id)
 {
    info("Creating 'stop_details' object");
    
    StopDetails sd = (StopDetails)malloc(sizeof(struct stop_details));
    
+   if (!sd) error("Unable to allocate memory for 'stop_details' object");
+   
+   memset(sd, 0, sizeof(struct stop_details));
+   
    sd->stop_id = stop_id;
+   sd->rf = route_filter_load(stop_id);
+   sd->status = "Loading...";
+   
+   if (departure_cache_get(stop_id, sd->departures, &sd->num_departures, sd->routes, &sd->num_routes, &sd->fetched))
+   {
+      info("Showing departures for stop %d cached %d seconds ago", stop_id, (int)(time(NULL) - sd->fetched));
+   }// End of if
    
    // Configure window
    sd->window = window_create();
@@ -130,6 +519,7 @@ StopDetails stop_details_create(int stop_id)
    window_set_fullscreen(sd->window, false);
    window_set_window_handlers(sd->window, (WindowHandlers) {
       .load = stop_details_handle_window_load,
+      .appear = stop_details_handle_window_appear,
       .unload = stop_details_handle_window_unload
    });
    window_set_user_data(sd->window, sd);
@@ -139,16 +529,20 @@ StopDetails stop_details_create(int stop_id)
 
 void stop_details_destroy(StopDetails sd)
 {
-   info("Destroying 'main_menu' object");
+   info("Destroying 'stop_details' object");
+   
+   departures_cancel(sd);
+   if (sd->ce) commute_editor_destroy(sd->ce);
    
    window_destroy(sd->window);
+   route_filter_destroy(sd->rf);
    free(sd);
 }// End of stop_details_destroy method
 
-void stop_details_show(StopDetails sd)
+void stop_details_show(StopDetails sd, bool animated)
 {
    info("Showing 'stop_details' window");
-   window_stack_push(sd->window, true);
+   window_stack_push(sd->window, animated);
 }// End of stop_details_show method
 
 void stop_details_hide(StopDetails sd)
@@ -156,3 +550,30 @@ void stop_details_hide(StopDetails sd)
    info("Hiding 'stop_details' window");
    window_stack_remove(sd->window, true);
 }// End of stop_details_hide method
+
+int stop_details_get_stop_id(StopDetails sd)
+{
+   return sd->stop_id;
+}// End of stop_details_get_stop_id method
+
+bool stop_details_is_on_stack(StopDetails sd)
+{
+   return window_stack_contains_window(sd->window);
+}// End of stop_details_is_on_stack method
+
+MenuIndex stop_details_get_selected(StopDetails sd)
+{
+   if (!sd->simple_menu_layer) return sd->selected;
+   
+   return menu_layer_get_selected_index(simple_menu_layer_get_menu_layer(sd->simple_menu_layer));
+}// End of stop_details_get_selected method
+
+void stop_details_set_selected(StopDetails sd, MenuIndex index)
+{
+   sd->selected = index;
+   
+   // Applied once the window loads; rows that don't exist yet are ignored
+   if (!sd->simple_menu_layer || index.section >= MENU_SECTIONS || index.row >= sd->sections[index.section].num_items) return;
+   
+   menu_layer_set_selected_index(simple_menu_layer_get_menu_layer(sd->simple_menu_layer), index, MenuRowAlignCenter, false);
+}// End of stop_details_set_selected method
@@ -33,7 +33,13 @@ typedef struct stop_details * StopDetails;
 StopDetails stop_details_create(int stop_id);
 void stop_details_destroy(StopDetails mm);
 
-void stop_details_show(StopDetails mm);
+void stop_details_show(StopDetails mm, bool animated);
 void stop_details_hide(StopDetails mm);
 
+int stop_details_get_stop_id(StopDetails sd);
+bool stop_details_is_on_stack(StopDetails sd);
+
+MenuIndex stop_details_get_selected(StopDetails sd);
+void stop_details_set_selected(StopDetails sd, MenuIndex index);
+
 #endif
\ No newline at end of file
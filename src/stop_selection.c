@@ -122,6 +122,8 @@ static void stop_selection_handle_window_load(Window* window)
    
    // Set selection on the first digit
    stop_selection_activate_digit(ss, 0);
+   
+   heap_usage("stop_selection");
 }// End of stop_selection_handle_window_load method
 
 static void stop_selection_handle_window_unload(Window* window)
@@ -0,0 +1,563 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "timetable.h"
+#include "message.h"
+#include "app_keys.h"
+
+#include "log.h"
+
+#define MAGIC "GRTT"
+#define ENTRY_LENGTH 4
+#define INDEX_BATCH 8
+
+#define ROUTE_MASK 0x1FFF
+#define DAYS_SHIFT 13
+#define DAY_WEEKDAY 1
+#define DAY_SATURDAY 2
+#define DAY_SUNDAY 4
+
+#define STATUS_DELAY_MS 2000
+#define STATUS_ATTEMPTS 5
+#define STATUS_MAX_BLOCKS 48
+
+#define STAGED 1
+
+typedef struct timetable_header
+{
+   char magic[4];
+   uint32_t version;
+   uint16_t num_blocks;
+   uint16_t reserved;
+} __attribute__((__packed__)) TimetableHeader;
+
+typedef struct timetable_index_entry
+{
+   uint16_t stop_id;
+   uint16_t crc;
+   uint16_t length;
+   uint16_t reserved;
+   uint32_t offset;
+} __attribute__((__packed__)) TimetableIndexEntry;
+
+// A patched block, stored in consecutive chunks. A length of 0 removes the
+// stop from the bundled timetable.
+typedef struct overlay_block
+{
+   uint16_t stop_id;
+   uint16_t crc;
+   uint16_t length;
+   uint8_t first_chunk;
+   uint8_t flags;
+} __attribute__((__packed__)) OverlayBlock;
+
+// Writing the manifest is what commits a patch
+typedef struct overlay
+{
+   uint32_t version;
+   uint8_t num_blocks;
+   uint8_t reserved[3];
+   OverlayBlock blocks[TIMETABLE_MAX_OVERLAY_BLOCKS];
+} __attribute__((__packed__)) Overlay;
+
+typedef struct fragment_header
+{
+   uint16_t stop_id;
+   uint16_t crc;
+   uint16_t length;
+   uint16_t offset;
+} __attribute__((__packed__)) FragmentHeader;
+
+// Where a stop's block is read from
+typedef struct timetable_block
+{
+   bool overlay;
+   uint8_t first_chunk;
+   uint16_t length;
+   uint32_t offset;
+} TimetableBlock;
+
+static ResHandle s_resource;
+static TimetableHeader s_header;
+static Overlay s_overlay;
+
+static Overlay s_staging;
+static bool s_staging_active = false;
+
+static AppTimer *s_status_timer = NULL;
+static int s_status_attempts = 0;
+
+// A version that can never fit in the overlay, reported so the phone stops sending it
+static uint32_t s_rejected = 0;
+// Fragments of an aborted patch are ignored until the next launch
+static uint32_t s_aborted = 0;
+
+static uint16_t crc16(uint16_t crc, const uint8_t *data, int length)
+{
+   // CRC-16/CCITT, as in tools/compile_timetable.py
+   for (int x = 0; x < length; ++x)
+   {
+      crc ^= data[x] << 8;
+      for (int bit = 0; bit < 8; ++bit) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+   }// End of for
+   
+   return crc;
+}// End of crc16 method
+
+static int chunks_for(int length)
+{
+   return (length + TIMETABLE_CHUNK_SIZE - 1) / TIMETABLE_CHUNK_SIZE;
+}// End of chunks_for method
+
+static int overlay_find(const Overlay *overlay, int stop_id)
+{
+   for (int x = 0; x < overlay->num_blocks; ++x)
+   {
+      if (overlay->blocks[x].stop_id == stop_id) return x;
+   }// End of for
+   
+   return -1;
+}// End of overlay_find method
+
+static bool overlay_uses_chunk(const Overlay *overlay, int chunk)
+{
+   for (int x = 0; x < overlay->num_blocks; ++x)
+   {
+      const OverlayBlock *block = &overlay->blocks[x];
+      if (chunk >= block->first_chunk && chunk < block->first_chunk + chunks_for(block->length)) return true;
+   }// End of for
+   
+   return false;
+}// End of overlay_uses_chunk method
+
+static bool chunk_in_use(int chunk)
+{
+   return overlay_uses_chunk(&s_overlay, chunk) || (s_staging_active && overlay_uses_chunk(&s_staging, chunk));
+}// End of chunk_in_use method
+
+// The committed blocks stay intact until the new manifest is written, so a
+// patch only ever writes to chunks neither manifest uses
+static int allocate_chunks(int count)
+{
+   for (int first = 0; first + count <= TIMETABLE_MAX_CHUNKS; ++first)
+   {
+      int x = 0;
+      while (x < count && !chunk_in_use(first + x)) ++x;
+      
+      if (x == count) return first;
+   }// End of for
+   
+   return -1;
+}// End of allocate_chunks method
+
+static void delete_unused_chunks(void)
+{
+   for (int x = 0; x < TIMETABLE_MAX_CHUNKS; ++x)
+   {
+      if (!chunk_in_use(x) && persist_exists(PERSIST_KEY_TIMETABLE_CHUNK + x)) persist_delete(PERSIST_KEY_TIMETABLE_CHUNK + x);
+   }// End of for
+}// End of delete_unused_chunks method
+
+static bool bundled_find(int stop_id, TimetableIndexEntry *found)
+{
+   TimetableIndexEntry entries[INDEX_BATCH];
+   
+   for (int first = 0; first < s_header.num_blocks; first += INDEX_BATCH)
+   {
+      int count = s_header.num_blocks - first;
+      if (count > INDEX_BATCH) count = INDEX_BATCH;
+      
+      resource_load_byte_range(s_resource, sizeof(TimetableHeader) + first * sizeof(TimetableIndexEntry), (uint8_t *)entries, count * sizeof(TimetableIndexEntry));
+      
+      for (int x = 0; x < count; ++x)
+      {
+         if (entries[x].stop_id != stop_id) continue;
+         
+         *found = entries[x];
+         return true;
+      }// End of for
+   }// End of for
+   
+   return false;
+}// End of bundled_find method
+
+static bool timetable_find_block(int stop_id, TimetableBlock *block)
+{
+   int index = overlay_find(&s_overlay, stop_id);
+   
+   if (index >= 0)
+   {
+      *block = (TimetableBlock) {
+         .overlay = true,
+         .first_chunk = s_overlay.blocks[index].first_chunk,
+         .length = s_overlay.blocks[index].length
+      };
+      return block->length > 0;
+   }// End of if
+   
+   TimetableIndexEntry entry;
+   if (!bundled_find(stop_id, &entry)) return false;
+   
+   *block = (TimetableBlock) {
+      .overlay = false,
+      .length = entry.length,
+      .offset = entry.offset
+   };
+   return block->length > 0;
+}// End of timetable_find_block method
+
+// Reads one TIMETABLE_CHUNK_SIZE piece of a block. Returns its length, or -1.
+static int timetable_read_chunk(const TimetableBlock *block, int chunk, uint8_t *buffer)
+{
+   int offset = chunk * TIMETABLE_CHUNK_SIZE;
+   int length = block->length - offset;
+   if (length > TIMETABLE_CHUNK_SIZE) length = TIMETABLE_CHUNK_SIZE;
+   
+   if (length <= 0) return -1;
+   
+   if (block->overlay)
+   {
+      return (persist_read_data(PERSIST_KEY_TIMETABLE_CHUNK + block->first_chunk + chunk, buffer, length) == length) ? length : -1;
+   }// End of if
+   
+   return (resource_load_byte_range(s_resource, block->offset + offset, buffer, length) == (size_t)length) ? length : -1;
+}// End of timetable_read_chunk method
+
+static void timetable_abort_patch(const char *reason, bool reject)
+{
+   warn("Discarding timetable patch: %s", reason);
+   
+   s_aborted = s_staging.version;
+   
+   if (reject)
+   {
+      s_rejected = s_staging.version;
+      persist_write_int(PERSIST_KEY_TIMETABLE_REJECTED, s_rejected);
+   }// End of if
+   
+   s_staging_active = false;
+   delete_unused_chunks();
+}// End of timetable_abort_patch method
+
+static void timetable_block_received(DictionaryIterator *iter)
+{
+   Tuple *version = dict_find(iter, KEY_TIMETABLE_VERSION);
+   Tuple *fragment = dict_find(iter, KEY_TIMETABLE_BLOCK);
+   
+   if (!version || fragment->length < sizeof(FragmentHeader))
+   {
+      warn("Ignoring invalid timetable fragment");
+      return;
+   }// End of if
+   
+   if (version->value->uint32 == s_aborted) return;
+   
+   // A new version starts a new patch over the committed overlay
+   if (!s_staging_active || s_staging.version != version->value->uint32)
+   {
+      info("Starting timetable patch to version %d", (int)version->value->uint32);
+      
+      s_staging = s_overlay;
+      s_staging.version = version->value->uint32;
+      s_staging_active = true;
+   }// End of if
+   
+   FragmentHeader header;
+   memcpy(&header, fragment->value->data, sizeof(FragmentHeader));
+   
+   const uint8_t *data = fragment->value->data + sizeof(FragmentHeader);
+   int data_length = fragment->length - sizeof(FragmentHeader);
+   
+   if (header.offset % TIMETABLE_CHUNK_SIZE != 0 || data_length > TIMETABLE_CHUNK_SIZE || header.offset + data_length > header.length)
+   {
+      timetable_abort_patch("fragment out of range", true);
+      return;
+   }// End of if
+   
+   int index = overlay_find(&s_staging, header.stop_id);
+   
+   if (header.offset == 0)
+   {
+      if (index < 0)
+      {
+         if (s_staging.num_blocks >= TIMETABLE_MAX_OVERLAY_BLOCKS)
+         {
+            timetable_abort_patch("too many blocks", true);
+            return;
+         }// End of if
+         
+         index = s_staging.num_blocks++;
+      }// End of if
+      
+      // Release whatever the stop used in the staging manifest
+      s_staging.blocks[index].length = 0;
+      
+      int first_chunk = (header.length > 0) ? allocate_chunks(chunks_for(header.length)) : 0;
+      if (first_chunk < 0)
+      {
+         timetable_abort_patch("out of space", true);
+         return;
+      }// End of if
+      
+      s_staging.blocks[index] = (OverlayBlock) {
+         .stop_id = header.stop_id,
+         .crc = header.crc,
+         .length = header.length,
+         .first_chunk = first_chunk,
+         .flags = STAGED
+      };
+   }// End of if
+   else if (index < 0 || !(s_staging.blocks[index].flags & STAGED) || s_staging.blocks[index].length != header.length)
+   {
+      timetable_abort_patch("fragment without a block", false);
+      return;
+   }// End of else if
+   
+   if (data_length == 0) return;
+   
+   int chunk = s_staging.blocks[index].first_chunk + header.offset / TIMETABLE_CHUNK_SIZE;
+   if (persist_write_data(PERSIST_KEY_TIMETABLE_CHUNK + chunk, data, data_length) != data_length)
+   {
+      timetable_abort_patch("unable to write chunk", false);
+   }// End of if
+}// End of timetable_block_received method
+
+static bool timetable_verify_block(const OverlayBlock *staged)
+{
+   TimetableBlock block = {
+      .overlay = true,
+      .first_chunk = staged->first_chunk,
+      .length = staged->length
+   };
+   
+   uint8_t buffer[TIMETABLE_CHUNK_SIZE];
+   uint16_t crc = 0xFFFF;
+   
+   for (int chunk = 0; chunk < chunks_for(block.length); ++chunk)
+   {
+      int length = timetable_read_chunk(&block, chunk, buffer);
+      if (length < 0) return false;
+      
+      crc = crc16(crc, buffer, length);
+   }// End of for
+   
+   return crc == staged->crc;
+}// End of timetable_verify_block method
+
+static void timetable_commit_received(DictionaryIterator *iter)
+{
+   Tuple *version = dict_find(iter, KEY_TIMETABLE_VERSION);
+   Tuple *commit = dict_find(iter, KEY_TIMETABLE_COMMIT);
+   
+   if (!version || version->value->uint32 == s_aborted) return;
+   
+   // A patch with no changed blocks still moves the version on
+   if (!s_staging_active || s_staging.version != version->value->uint32)
+   {
+      s_staging = s_overlay;
+      s_staging.version = version->value->uint32;
+      s_staging_active = true;
+   }// End of if
+   
+   int num_staged = 0;
+   
+   for (int x = 0; x < s_staging.num_blocks; ++x)
+   {
+      OverlayBlock *block = &s_staging.blocks[x];
+      if (!(block->flags & STAGED)) continue;
+      
+      if (block->length > 0 && !timetable_verify_block(block))
+      {
+         warn("Checksum mismatch for stop: %d", block->stop_id);
+         timetable_abort_patch("checksum mismatch", false);
+         return;
+      }// End of if
+      
+      block->flags &= ~STAGED;
+      ++num_staged;
+   }// End of for
+   
+   if (num_staged != (int)commit->value->uint32)
+   {
+      timetable_abort_patch("missing blocks", false);
+      return;
+   }// End of if
+   
+   int bytes = persist_write_data(PERSIST_KEY_TIMETABLE_MANIFEST, &s_staging, sizeof(Overlay) - sizeof(s_staging.blocks) + s_staging.num_blocks * sizeof(OverlayBlock));
+   if (bytes < 0)
+   {
+      timetable_abort_patch("unable to write manifest", false);
+      return;
+   }// End of if
+   
+   s_overlay = s_staging;
+   s_staging_active = false;
+   delete_unused_chunks();
+   
+   if (s_rejected)
+   {
+      persist_delete(PERSIST_KEY_TIMETABLE_REJECTED);
+      s_rejected = 0;
+   }// End of if
+   
+   info("Timetable patched to version %d, %d blocks changed", (int)s_overlay.version, num_staged);
+}// End of timetable_commit_received method
+
+static void timetable_send_status(void *context)
+{
+   s_status_timer = NULL;
+   
+   DictionaryIterator *iter;
+   if (app_message_outbox_begin(&iter) != APP_MSG_OK)
+   {
+      // Another request is in flight, try again shortly
+      if (++s_status_attempts < STATUS_ATTEMPTS) s_status_timer = app_timer_register(STATUS_DELAY_MS, timetable_send_status, NULL);
+      return;
+   }// End of if
+   
+   // Checksums of every block the watch currently reads, as stop/crc pairs
+   uint16_t checksums[STATUS_MAX_BLOCKS * 2];
+   int num_checksums = 0;
+   
+   TimetableIndexEntry entry;
+   for (int x = 0; x < s_header.num_blocks && num_checksums < STATUS_MAX_BLOCKS; ++x)
+   {
+      resource_load_byte_range(s_resource, sizeof(TimetableHeader) + x * sizeof(TimetableIndexEntry), (uint8_t *)&entry, sizeof(TimetableIndexEntry));
+      if (overlay_find(&s_overlay, entry.stop_id) >= 0) continue;
+      
+      checksums[num_checksums * 2] = entry.stop_id;
+      checksums[num_checksums * 2 + 1] = entry.crc;
+      ++num_checksums;
+   }// End of for
+   
+   for (int x = 0; x < s_overlay.num_blocks && num_checksums < STATUS_MAX_BLOCKS; ++x)
+   {
+      if (s_overlay.blocks[x].length == 0) continue;
+      
+      checksums[num_checksums * 2] = s_overlay.blocks[x].stop_id;
+      checksums[num_checksums * 2 + 1] = s_overlay.blocks[x].crc;
+      ++num_checksums;
+   }// End of for
+   
+   uint32_t version = (s_overlay.version > s_header.version) ? s_overlay.version : s_header.version;
+   
+   info("Sending timetable version %d with %d blocks", (int)version, num_checksums);
+   
+   dict_write_uint32(iter, KEY_TIMETABLE_VERSION, version);
+   if (num_checksums > 0) dict_write_data(iter, KEY_TIMETABLE_CHECKSUMS, (const uint8_t *)checksums, num_checksums * 2 * sizeof(uint16_t));
+   if (s_rejected > version) dict_write_uint32(iter, KEY_TIMETABLE_REJECTED, s_rejected);
+   dict_write_end(iter);
+   
+   app_message_outbox_send();
+}// End of timetable_send_status method
+
+void timetable_init(void)
+{
+   info("Loading timetable");
+   
+   s_resource = resource_get_handle(RESOURCE_ID_TIMETABLE);
+   
+   if (resource_load_byte_range(s_resource, 0, (uint8_t *)&s_header, sizeof(TimetableHeader)) != sizeof(TimetableHeader) || memcmp(s_header.magic, MAGIC, 4) != 0)
+   {
+      error("Bundled timetable is invalid");
+      memset(&s_header, 0, sizeof(TimetableHeader));
+   }// End of if
+   
+   memset(&s_overlay, 0, sizeof(Overlay));
+   if (persist_exists(PERSIST_KEY_TIMETABLE_MANIFEST)) persist_read_data(PERSIST_KEY_TIMETABLE_MANIFEST, &s_overlay, sizeof(Overlay));
+   
+   if (s_overlay.num_blocks > TIMETABLE_MAX_OVERLAY_BLOCKS) s_overlay.num_blocks = 0;
+   
+   // A reinstall with a newer bundled timetable replaces any patches
+   if (s_overlay.version <= s_header.version && persist_exists(PERSIST_KEY_TIMETABLE_MANIFEST))
+   {
+      info("Discarding timetable patches older than the bundled version %d", (int)s_header.version);
+      
+      persist_delete(PERSIST_KEY_TIMETABLE_MANIFEST);
+      memset(&s_overlay, 0, sizeof(Overlay));
+   }// End of if
+   
+   delete_unused_chunks();
+   
+   s_rejected = persist_exists(PERSIST_KEY_TIMETABLE_REJECTED) ? persist_read_int(PERSIST_KEY_TIMETABLE_REJECTED) : 0;
+   s_aborted = 0;
+   
+   debug("Timetable version %d with %d bundled and %d patched blocks", (int)s_header.version, s_header.num_blocks, s_overlay.num_blocks);
+   
+   message_register(KEY_TIMETABLE_BLOCK, timetable_block_received);
+   message_register(KEY_TIMETABLE_COMMIT, timetable_commit_received);
+   
+   // Let the first screen's request go out before asking the phone for updates
+   s_status_attempts = 0;
+   s_status_timer = app_timer_register(STATUS_DELAY_MS, timetable_send_status, NULL);
+}// End of timetable_init method
+
+void timetable_deinit(void)
+{
+   if (s_status_timer) app_timer_cancel(s_status_timer);
+   s_status_timer = NULL;
+}// End of timetable_deinit method
+
+int timetable_next_departures(int stop_id, time_t now, RouteFilter rf, Departure *departures, int max_departures)
+{
+   TimetableBlock block;
+   if (!timetable_find_block(stop_id, &block)) return 0;
+   
+   struct tm tm = *localtime(&now);
+   
+   int day = (tm.tm_wday == 0) ? DAY_SUNDAY : (tm.tm_wday == 6) ? DAY_SATURDAY : DAY_WEEKDAY;
+   int minutes = tm.tm_hour * 60 + tm.tm_min;
+   time_t midnight = now - (minutes * 60 + tm.tm_sec);
+   
+   uint8_t buffer[TIMETABLE_CHUNK_SIZE];
+   int num_departures = 0;
+   
+   for (int chunk = 0; chunk < chunks_for(block.length) && num_departures < max_departures; ++chunk)
+   {
+      int length = timetable_read_chunk(&block, chunk, buffer);
+      if (length < 0) break;
+      
+      for (int x = 0; x + ENTRY_LENGTH <= length && num_departures < max_departures; x += ENTRY_LENGTH)
+      {
+         int departure_minutes = buffer[x] | (buffer[x + 1] << 8);
+         int route_days = buffer[x + 2] | (buffer[x + 3] << 8);
+         int route = route_days & ROUTE_MASK;
+         
+         if (departure_minutes < minutes || !((route_days >> DAYS_SHIFT) & day)) continue;
+         if (rf && !route_filter_allows(rf, route)) continue;
+         
+         Departure *departure = &departures[num_departures++];
+         
+         departure->route = route;
+         departure->time = midnight + departure_minutes * 60;
+         strncpy(departure->headsign, "Scheduled", DEPARTURE_HEADSIGN_LENGTH);
+      }// End of for
+   }// End of for
+   
+   debug("Found %d scheduled departures for stop: %d", num_departures, stop_id);
+   
+   return num_departures;
+}// End of timetable_next_departures method
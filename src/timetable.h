@@ -0,0 +1,48 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "departures.h"
+#include "route_filter.h"
+
+#ifndef _timetable_h
+#define _timetable_h
+
+// Scheduled departures for a few stops, bundled as the TIMETABLE resource
+// (built by tools/compile_timetable.py --watch). The phone patches changed
+// stop blocks into persistent storage, which overlays the resource.
+
+// Patch fragments carry at most one chunk of block data
+#define TIMETABLE_CHUNK_SIZE 128
+#define TIMETABLE_MAX_CHUNKS 16
+#define TIMETABLE_MAX_OVERLAY_BLOCKS 16
+
+void timetable_init(void);
+void timetable_deinit(void);
+
+// Fills departures from the schedule, for when the phone can't be reached
+int timetable_next_departures(int stop_id, time_t now, RouteFilter rf, Departure *departures, int max_departures);
+
+#endif
@@ -0,0 +1,274 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "trip_plan.h"
+#include "trips.h"
+#include "nav_state.h"
+
+#include "log.h"
+
+#define MENU_SECTIONS 2
+#define MENU_ITEMS_SECTION_1 1
+#define MENU_ITEMS_SECTION_2 TRIPS_MAX_LEGS
+
+#define TITLE_LENGTH 24
+#define SUBTITLE_LENGTH 24
+#define TIME_LENGTH 10
+
+struct trip_plan
+{
+   int from_stop;
+   int to_stop;
+   
+   Window *window;
+   
+   SimpleMenuLayer *simple_menu_layer;
+   
+   SimpleMenuSection sections[MENU_SECTIONS];
+   SimpleMenuItem items1[MENU_ITEMS_SECTION_1];
+   SimpleMenuItem items2[MENU_ITEMS_SECTION_2];
+   
+   char trip_title[TITLE_LENGTH];
+   char trip_subtitle[SUBTITLE_LENGTH];
+   const char *status;
+   
+   TripLeg legs[TRIPS_MAX_LEGS];
+   int num_legs;
+   char leg_titles[TRIPS_MAX_LEGS][TITLE_LENGTH];
+   char leg_subtitles[TRIPS_MAX_LEGS][SUBTITLE_LENGTH];
+} __attribute__((aligned(1)));
+
+static void trip_plan_request(TripPlan tp);
+
+static void trip_plan_trip_selected(int index, void *context)
+{
+   TripPlan tp = (TripPlan)context;
+   
+   info("Planning trip from %d to %d again", tp->from_stop, tp->to_stop);
+   trip_plan_request(tp);
+}// End of trip_plan_trip_selected method
+
+static void format_time(char *buffer, size_t length, uint32_t time)
+{
+   time_t t = time;
+   strftime(buffer, length, clock_is_24h_style() ? "%H:%M" : "%I:%M %p", localtime(&t));
+}// End of format_time method
+
+static void trip_plan_update(TripPlan tp)
+{
+   debug("Updating 'trip_plan' legs");
+   
+   snprintf(tp->trip_title, TITLE_LENGTH, "%d to %d", tp->from_stop, tp->to_stop);
+   
+   if (tp->num_legs == 0)
+   {
+      snprintf(tp->trip_subtitle, SUBTITLE_LENGTH, "%s", tp->status);
+   }// End of if
+   else
+   {
+      char arrival[TIME_LENGTH];
+      format_time(arrival, TIME_LENGTH, tp->legs[tp->num_legs - 1].arrival);
+      snprintf(tp->trip_subtitle, SUBTITLE_LENGTH, "Arrive %s", arrival);
+   }// End of else
+   
+   // Selecting the trip plans it again
+   tp->items1[0] = (SimpleMenuItem) {
+      .title = tp->trip_title,
+      .subtitle = tp->trip_subtitle,
+      .callback = trip_plan_trip_selected
+   };
+   
+   for (int x = 0; x < tp->num_legs; ++x)
+   {
+      TripLeg *leg = &tp->legs[x];
+      char departure[TIME_LENGTH], arrival[TIME_LENGTH];
+      
+      format_time(departure, TIME_LENGTH, leg->departure);
+      format_time(arrival, TIME_LENGTH, leg->arrival);
+      
+      snprintf(tp->leg_titles[x], TITLE_LENGTH, "Route %d at %s", leg->route, departure);
+      snprintf(tp->leg_subtitles[x], SUBTITLE_LENGTH, "%d to %d, %s", leg->from_stop, leg->to_stop, arrival);
+      
+      tp->items2[x] = (SimpleMenuItem) {
+         .title = tp->leg_titles[x],
+         .subtitle = tp->leg_subtitles[x]
+      };
+   }// End of for
+   
+   if (tp->num_legs == 0)
+   {
+      tp->items2[0] = (SimpleMenuItem) {
+         .title = "--",
+         .subtitle = "--"
+      };
+   }// End of if
+   
+   tp->sections[1].num_items = (tp->num_legs > 0) ? tp->num_legs : 1;
+   
+   if (tp->simple_menu_layer) menu_layer_reload_data(simple_menu_layer_get_menu_layer(tp->simple_menu_layer));
+}// End of trip_plan_update method
+
+static void trip_plan_trip_planned(const TripLeg *legs, int num_legs, void *context)
+{
+   TripPlan tp = (TripPlan)context;
+   
+   memcpy(tp->legs, legs, num_legs * sizeof(TripLeg));
+   tp->num_legs = num_legs;
+   tp->status = "No trip found";
+   
+   trip_plan_update(tp);
+   
+   nav_state_mark_ready("trip_plan");
+}// End of trip_plan_trip_planned method
+
+static void trip_plan_trip_failed(void *context)
+{
+   TripPlan tp = (TripPlan)context;
+   
+   tp->num_legs = 0;
+   tp->status = "Unable to connect";
+   
+   trip_plan_update(tp);
+}// End of trip_plan_trip_failed method
+
+static void trip_plan_request(TripPlan tp)
+{
+   tp->status = trips_request(tp->from_stop, tp->to_stop, trip_plan_trip_planned, trip_plan_trip_failed, tp) ? "Planning..." : "Unable to connect";
+   tp->num_legs = 0;
+   
+   trip_plan_update(tp);
+}// End of trip_plan_request method
+
+static void trip_plan_handle_window_load(Window *window)
+{
+   TripPlan tp = (TripPlan)window_get_user_data(window);
+   
+   // Init GUI components
+   info("Initializing 'trip_plan' GUI components");
+   
+   Layer *window_layer = window_get_root_layer(window);
+   GRect bounds = layer_get_frame(window_layer);
+   
+   // Create menu sections
+   int section = 0;
+   
+   tp->sections[section++] = (SimpleMenuSection) {
+     .title = "Trip",
+     .items = tp->items1,
+     .num_items = MENU_ITEMS_SECTION_1
+   };
+   
+   tp->sections[section++] = (SimpleMenuSection) {
+     .title = "Itinerary",
+     .items = tp->items2,
+     .num_items = MENU_ITEMS_SECTION_2
+   };
+   
+   trip_plan_request(tp);
+   
+   tp->simple_menu_layer = simple_menu_layer_create(bounds, window, tp->sections, MENU_SECTIONS, tp);
+   layer_add_child(window_layer, simple_menu_layer_get_layer(tp->simple_menu_layer));
+   
+   heap_usage("trip_plan");
+}// End of trip_plan_handle_window_load method
+
+static void trip_plan_handle_window_unload(Window *window)
+{
+   TripPlan tp = (TripPlan)window_get_user_data(window);
+   
+   // Unload GUI components
+   info("Destroying 'trip_plan' GUI components");
+   
+   trips_cancel(tp);
+   
+   simple_menu_layer_destroy(tp->simple_menu_layer);
+   tp->simple_menu_layer = NULL;
+}// End of trip_plan_handle_window_unload method
+
+TripPlan trip_plan_create(int from_stop, int to_stop)
+{
+   info("Creating 'trip_plan' object");
+   
+   TripPlan tp = (TripPlan)malloc(sizeof(struct trip_plan));
+   
+   if (!tp) error("Unable to allocate memory for 'trip_plan' object");
+   
+   memset(tp, 0, sizeof(struct trip_plan));
+   
+   tp->from_stop = from_stop;
+   tp->to_stop = to_stop;
+   
+   // Configure window
+   tp->window = window_create();
+   
+   if (!(tp->window)) error("Unable to allocate memory for 'window' object");
+   
+   window_set_fullscreen(tp->window, false);
+   window_set_window_handlers(tp->window, (WindowHandlers) {
+      .load = trip_plan_handle_window_load,
+      .unload = trip_plan_handle_window_unload
+   });
+   window_set_user_data(tp->window, tp);
+   
+   return tp;
+}// End of trip_plan_create method
+
+void trip_plan_destroy(TripPlan tp)
+{
+   info("Destroying 'trip_plan' object");
+   
+   trips_cancel(tp);
+   
+   window_destroy(tp->window);
+   free(tp);
+}// End of trip_plan_destroy method
+
+void trip_plan_show(TripPlan tp, bool animated)
+{
+   info("Showing 'trip_plan' window");
+   window_stack_push(tp->window, animated);
+}// End of trip_plan_show method
+
+void trip_plan_hide(TripPlan tp)
+{
+   info("Hiding 'trip_plan' window");
+   window_stack_remove(tp->window, true);
+}// End of trip_plan_hide method
+
+int trip_plan_get_from_stop(TripPlan tp)
+{
+   return tp->from_stop;
+}// End of trip_plan_get_from_stop method
+
+int trip_plan_get_to_stop(TripPlan tp)
+{
+   return tp->to_stop;
+}// End of trip_plan_get_to_stop method
+
+bool trip_plan_is_on_stack(TripPlan tp)
+{
+   return window_stack_contains_window(tp->window);
+}// End of trip_plan_is_on_stack method
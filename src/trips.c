@@ -0,0 +1,184 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#include "trips.h"
+#include "message.h"
+#include "app_keys.h"
+
+#include "log.h"
+
+// The phone may have to download the day's timetable before planning
+#define TIMEOUT_MS 30000
+
+static int s_from_stop = -1;
+static int s_to_stop = -1;
+static TripPlannedCallback s_callback = NULL;
+static TripFailedCallback s_failed = NULL;
+static void *s_context = NULL;
+static AppTimer *s_timer = NULL;
+
+// Forgets the pending request
+static void trips_clear(void)
+{
+   if (s_timer) app_timer_cancel(s_timer);
+   
+   s_from_stop = -1;
+   s_to_stop = -1;
+   s_callback = NULL;
+   s_failed = NULL;
+   s_context = NULL;
+   s_timer = NULL;
+}// End of trips_clear method
+
+static void trips_fail(void)
+{
+   TripFailedCallback failed = s_failed;
+   void *failed_context = s_context;
+   
+   trips_clear();
+   
+   if (failed) failed(failed_context);
+}// End of trips_fail method
+
+static void trips_timed_out(void *context)
+{
+   warn("Timed out waiting for trip from %d to %d", s_from_stop, s_to_stop);
+   
+   s_timer = NULL;
+   trips_fail();
+}// End of trips_timed_out method
+
+static bool trips_is_pending(DictionaryIterator *iter)
+{
+   Tuple *from_stop = dict_find(iter, KEY_TRIP_FROM);
+   Tuple *to_stop = dict_find(iter, KEY_TRIP_TO);
+   
+   return from_stop && to_stop && s_callback && (int)from_stop->value->int32 == s_from_stop && (int)to_stop->value->int32 == s_to_stop;
+}// End of trips_is_pending method
+
+static void trips_send_failed(DictionaryIterator *iter, AppMessageResult reason)
+{
+   if (!trips_is_pending(iter)) return;
+   
+   warn("Unable to deliver trip request from %d to %d: %d", s_from_stop, s_to_stop, reason);
+   trips_fail();
+}// End of trips_send_failed method
+
+// The phone couldn't load today's timetable
+static void trips_error_received(DictionaryIterator *iter)
+{
+   if (!trips_is_pending(iter)) return;
+   
+   warn("Phone unable to plan trip from %d to %d", s_from_stop, s_to_stop);
+   trips_fail();
+}// End of trips_error_received method
+
+static void trips_received(DictionaryIterator *iter)
+{
+   Tuple *from_stop = dict_find(iter, KEY_TRIP_FROM);
+   Tuple *to_stop = dict_find(iter, KEY_TRIP_TO);
+   Tuple *legs = dict_find(iter, KEY_TRIP_LEGS);
+   
+   if (!from_stop || !to_stop)
+   {
+      warn("Ignoring trip without stops");
+      return;
+   }// End of if
+   
+   if ((int)from_stop->value->int32 != s_from_stop || (int)to_stop->value->int32 != s_to_stop || !s_callback)
+   {
+      info("Ignoring trip from %d to %d", (int)from_stop->value->int32, (int)to_stop->value->int32);
+      return;
+   }// End of if
+   
+   int num_legs = legs ? legs->length / sizeof(TripLeg) : 0;
+   if (num_legs > TRIPS_MAX_LEGS) num_legs = TRIPS_MAX_LEGS;
+   
+   info("Received trip from %d to %d with %d legs", s_from_stop, s_to_stop, num_legs);
+   
+   // Byte arrays are not aligned within the dictionary
+   TripLeg received[TRIPS_MAX_LEGS];
+   if (legs) memcpy(received, legs->value->data, num_legs * sizeof(TripLeg));
+   
+   TripPlannedCallback callback = s_callback;
+   void *callback_context = s_context;
+   
+   trips_clear();
+   
+   callback(received, num_legs, callback_context);
+}// End of trips_received method
+
+void trips_init(void)
+{
+   message_register(KEY_TRIP_LEGS, trips_received);
+   message_register(KEY_TRIP_ERROR, trips_error_received);
+   message_register_failed(KEY_TRIP_FROM, trips_send_failed);
+}// End of trips_init method
+
+bool trips_request(int from_stop, int to_stop, TripPlannedCallback callback, TripFailedCallback failed, void *context)
+{
+   info("Requesting trip from %d to %d", from_stop, to_stop);
+   
+   DictionaryIterator *iter;
+   AppMessageResult result = app_message_outbox_begin(&iter);
+   
+   if (result != APP_MSG_OK)
+   {
+      warn("Unable to begin trip request: %d", result);
+      return false;
+   }// End of if
+   
+   dict_write_int32(iter, KEY_TRIP_FROM, from_stop);
+   dict_write_int32(iter, KEY_TRIP_TO, to_stop);
+   dict_write_end(iter);
+   
+   result = app_message_outbox_send();
+   if (result != APP_MSG_OK)
+   {
+      warn("Unable to send trip request: %d", result);
+      return false;
+   }// End of if
+   
+   trips_clear();
+   
+   s_from_stop = from_stop;
+   s_to_stop = to_stop;
+   s_callback = callback;
+   s_failed = failed;
+   s_context = context;
+   s_timer = app_timer_register(TIMEOUT_MS, trips_timed_out, NULL);
+   
+   return true;
+}// End of trips_request method
+
+void trips_cancel(void *context)
+{
+   if (s_context != context) return;
+   
+   debug("Cancelling trip request from %d to %d", s_from_stop, s_to_stop);
+   
+   trips_clear();
+}// End of trips_cancel method
@@ -0,0 +1,54 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <pebble.h>
+
+#ifndef _trips_h
+#define _trips_h
+
+#define TRIPS_MAX_LEGS 6
+
+// Wire format of one ride in an itinerary, packed little endian by the phone
+typedef struct trip_leg
+{
+   uint16_t route;
+   uint16_t from_stop;
+   uint16_t to_stop;
+   uint32_t departure; // Local time, seconds since the epoch
+   uint32_t arrival;
+} __attribute__((__packed__)) TripLeg;
+
+// num_legs is 0 when the phone found no trip
+typedef void (*TripPlannedCallback)(const TripLeg *legs, int num_legs, void *context);
+
+// Called instead when the request can't be delivered, the phone has no
+// timetable for today, or the reply doesn't arrive in time
+typedef void (*TripFailedCallback)(void *context);
+
+void trips_init(void);
+
+bool trips_request(int from_stop, int to_stop, TripPlannedCallback callback, TripFailedCallback failed, void *context);
+void trips_cancel(void *context);
+
+#endif
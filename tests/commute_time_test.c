@@ -0,0 +1,142 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+// Host test for the commute scheduling arithmetic: make test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commute_time.h"
+
+static int s_failures = 0;
+
+#define check(condition) do { if (!(condition)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); ++s_failures; } } while (0)
+
+// Local time in the test's time zone
+static time_t local(int year, int month, int day, int hour, int minute)
+{
+   struct tm tm;
+   memset(&tm, 0, sizeof(tm));
+   
+   tm.tm_year = year - 1900;
+   tm.tm_mon = month - 1;
+   tm.tm_mday = day;
+   tm.tm_hour = hour;
+   tm.tm_min = minute;
+   tm.tm_isdst = -1;
+   
+   return mktime(&tm);
+}// End of local method
+
+static void test_week_wrap(void)
+{
+   CommuteWindow weekdays = { .stop_id = 1234, .hour = 8, .minute = 5, .days = COMMUTE_DAYS_WEEKDAYS };
+   CommuteWindow saturdays = { .stop_id = 2345, .hour = 8, .minute = 5, .days = 1 << 6 };
+   
+   // Friday 2014-10-24 after the commute goes to Monday
+   check(commute_next_occurrence(&weekdays, local(2014, 10, 24, 9, 0)) == local(2014, 10, 27, 8, 5));
+   
+   // Friday before the commute is today
+   check(commute_next_occurrence(&weekdays, local(2014, 10, 24, 7, 0)) == local(2014, 10, 24, 8, 5));
+   
+   // A single day just missed comes around a week later
+   check(commute_next_occurrence(&saturdays, local(2014, 10, 25, 8, 6)) == local(2014, 11, 1, 8, 5));
+   
+   // The commute time itself has started, so it is not next
+   check(commute_next_occurrence(&saturdays, local(2014, 10, 25, 8, 5)) == local(2014, 11, 1, 8, 5));
+}// End of test_week_wrap method
+
+static void test_daylight_saving(void)
+{
+   CommuteWindow daily = { .stop_id = 1234, .hour = 8, .minute = 5, .days = COMMUTE_DAYS_DAILY };
+   
+   // Clocks go forward on Sunday 2014-03-09, a 23 hour day
+   time_t spring = commute_next_occurrence(&daily, local(2014, 3, 8, 9, 0));
+   check(spring == local(2014, 3, 9, 8, 5));
+   check(spring - local(2014, 3, 8, 8, 5) == 23 * 3600);
+   
+   // Clocks go back on Sunday 2014-11-02, a 25 hour day
+   time_t fall = commute_next_occurrence(&daily, local(2014, 11, 1, 9, 0));
+   check(fall == local(2014, 11, 2, 8, 5));
+   check(fall - local(2014, 11, 1, 8, 5) == 25 * 3600);
+   
+   // Still 8:05 on the clock after the change
+   struct tm *tm = localtime(&fall);
+   check(tm->tm_hour == 8 && tm->tm_min == 5);
+}// End of test_daylight_saving method
+
+static void test_prefetch_margin(void)
+{
+   CommuteWindow windows[] = {
+      { .stop_id = 1234, .hour = 8, .minute = 5, .days = COMMUTE_DAYS_DAILY },
+      { .stop_id = 2345, .hour = 17, .minute = 30, .days = COMMUTE_DAYS_WEEKDAYS }
+   };
+   
+   time_t commute = local(2014, 10, 20, 8, 5);
+   time_t prefetch_time = 0;
+   
+   // Outside the margin the wakeup is today's
+   check(commute_next_prefetch(windows, 2, commute - COMMUTE_PREFETCH_LEAD - COMMUTE_SCHEDULE_MARGIN - 1, &prefetch_time) == 0);
+   check(prefetch_time == commute - COMMUTE_PREFETCH_LEAD);
+   
+   // Inside the margin it counts as handled and the evening commute is next
+   check(commute_next_prefetch(windows, 2, commute - COMMUTE_PREFETCH_LEAD - COMMUTE_SCHEDULE_MARGIN + 1, &prefetch_time) == 1);
+   check(prefetch_time == local(2014, 10, 20, 17, 30) - COMMUTE_PREFETCH_LEAD);
+   
+   check(commute_next_prefetch(windows, 0, commute, &prefetch_time) == -1);
+}// End of test_prefetch_margin method
+
+static void test_current(void)
+{
+   CommuteWindow windows[] = {
+      { .stop_id = 1234, .hour = 8, .minute = 5, .days = COMMUTE_DAYS_WEEKDAYS }
+   };
+   
+   time_t monday = local(2014, 10, 20, 8, 5);
+   time_t saturday = local(2014, 10, 25, 8, 5);
+   
+   check(commute_current(windows, 1, monday - COMMUTE_PREFETCH_LEAD) == 0);
+   check(commute_current(windows, 1, monday - COMMUTE_PREFETCH_LEAD - 1) == -1);
+   check(commute_current(windows, 1, monday + COMMUTE_ACTIVE_AFTER) == 0);
+   check(commute_current(windows, 1, monday + COMMUTE_ACTIVE_AFTER + 1) == -1);
+   check(commute_current(windows, 1, saturday) == -1);
+}// End of test_current method
+
+int main(void)
+{
+   // GRT's time zone, with its daylight saving rules written out
+   setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+   tzset();
+   
+   test_week_wrap();
+   test_daylight_saving();
+   test_prefetch_margin();
+   test_current();
+   
+   if (s_failures) return 1;
+   
+   printf("commute_time: all checks passed\n");
+   return 0;
+}// End of main method
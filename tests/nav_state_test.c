@@ -0,0 +1,249 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+// Host test for restoring the app on launch, against the fake SDK in
+// tests/pebble.h: make test
+
+#include <stdarg.h>
+
+#include <pebble.h>
+
+#include "nav_state.h"
+#include "departure_cache.h"
+#include "app_keys.h"
+
+static int s_failures = 0;
+
+#define check(condition) do { if (!(condition)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); ++s_failures; } } while (0)
+
+// Persistent storage, kept in memory
+
+#define FAKE_PERSIST_KEYS 16
+
+static struct
+{
+   uint32_t key;
+   size_t size;
+   uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} s_persist[FAKE_PERSIST_KEYS];
+static int s_num_persist = 0;
+
+static int persist_find(uint32_t key)
+{
+   for (int x = 0; x < s_num_persist; ++x)
+   {
+      if (s_persist[x].key == key) return x;
+   }// End of for
+   
+   return -1;
+}// End of persist_find method
+
+bool persist_exists(const uint32_t key)
+{
+   return persist_find(key) >= 0;
+}// End of persist_exists method
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size)
+{
+   int x = persist_find(key);
+   if (x < 0) return -1;
+   
+   size_t size = (s_persist[x].size < buffer_size) ? s_persist[x].size : buffer_size;
+   memcpy(buffer, s_persist[x].data, size);
+   
+   return size;
+}// End of persist_read_data method
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size)
+{
+   if (size > PERSIST_DATA_MAX_LENGTH) return -1;
+   
+   int x = persist_find(key);
+   if (x < 0)
+   {
+      if (s_num_persist == FAKE_PERSIST_KEYS) return -1;
+      x = s_num_persist++;
+   }// End of if
+   
+   s_persist[x].key = key;
+   s_persist[x].size = size;
+   memcpy(s_persist[x].data, data, size);
+   
+   return size;
+}// End of persist_write_data method
+
+// The millisecond clock only moves when a test sets it
+
+static time_t s_clock_seconds;
+static uint16_t s_clock_ms;
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms)
+{
+   if (tloc) *tloc = s_clock_seconds;
+   if (out_ms) *out_ms = s_clock_ms;
+   
+   return s_clock_ms;
+}// End of time_ms method
+
+size_t heap_bytes_used(void)
+{
+   return 0;
+}// End of heap_bytes_used method
+
+// Keeps the last line logged
+
+static char s_log[256];
+static int s_num_logs = 0;
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...)
+{
+   (void)log_level;
+   (void)src_filename;
+   (void)src_line_number;
+   
+   va_list args;
+   va_start(args, fmt);
+   vsnprintf(s_log, sizeof(s_log), fmt, args);
+   va_end(args);
+   
+   ++s_num_logs;
+}// End of app_log method
+
+static NavState saved_at(time_t saved)
+{
+   return (NavState) {
+      .screen = NAV_SCREEN_STOP_DETAILS,
+      .section = 1,
+      .row = 2,
+      .stop_id = 1234,
+      .saved = saved
+   };
+}// End of saved_at method
+
+static void test_round_trip(void)
+{
+   NavState state;
+   
+   check(!nav_state_load(&state));
+   
+   NavState saved = saved_at(time(NULL) - 60);
+   nav_state_save(&saved);
+   
+   check(nav_state_load(&state));
+   check(memcmp(&state, &saved, sizeof(NavState)) == 0);
+}// End of test_round_trip method
+
+static void test_expiry(void)
+{
+   NavState state;
+   time_t now = time(NULL);
+   
+   state = saved_at(now - NAV_STATE_MAX_AGE + 60);
+   nav_state_save(&state);
+   check(nav_state_load(&state));
+   
+   state = saved_at(now - NAV_STATE_MAX_AGE - 60);
+   nav_state_save(&state);
+   check(!nav_state_load(&state));
+   
+   // Saved by a clock that was ahead, e.g. before a time zone change
+   state = saved_at(now + 60 * 60);
+   nav_state_save(&state);
+   check(!nav_state_load(&state));
+}// End of test_expiry method
+
+static void test_short_read(void)
+{
+   NavState state;
+   uint32_t old_format = time(NULL);
+   
+   persist_write_data(PERSIST_KEY_NAV_STATE, &old_format, sizeof(old_format));
+   check(!nav_state_load(&state));
+}// End of test_short_read method
+
+static void test_launch_to_ready(void)
+{
+   // Only a launch that restored a screen is timed
+   int logs = s_num_logs;
+   nav_state_mark_ready("stop_details");
+   check(s_num_logs == logs);
+   
+   s_clock_seconds = 1000;
+   s_clock_ms = 900;
+   nav_state_mark_launch();
+   
+   s_clock_seconds = 1001;
+   s_clock_ms = 150;
+   nav_state_mark_ready("stop_details");
+   check(s_num_logs == logs + 1);
+   check(strcmp(s_log, "Launch to useful 'stop_details' in 250 ms") == 0);
+   
+   // Later updates don't count again
+   s_clock_seconds = 1005;
+   nav_state_mark_ready("stop_details");
+   check(s_num_logs == logs + 1);
+}// End of test_launch_to_ready method
+
+static void test_cached_departures(void)
+{
+   Departure departures[DEPARTURES_MAX] = {
+      { .route = 7, .time = 1413806400, .headsign = "Mall" },
+      { .route = 12, .time = 1413806700, .headsign = "Uptown" }
+   };
+   uint16_t routes[DEPARTURES_MAX_ROUTES] = { 7, 12, 20 };
+   
+   departure_cache_put(1234, departures, 2, routes, 3);
+   departure_cache_put(5678, departures, 1, routes, 1);
+   
+   Departure cached[DEPARTURES_MAX];
+   uint16_t cached_routes[DEPARTURES_MAX_ROUTES];
+   int num_departures, num_routes;
+   time_t fetched;
+   
+   check(departure_cache_get(1234, cached, &num_departures, cached_routes, &num_routes, &fetched));
+   check(num_departures == 2);
+   check(num_routes == 3);
+   check(time(NULL) - fetched <= 1);
+   check(memcmp(cached, departures, 2 * sizeof(Departure)) == 0);
+   check(memcmp(cached_routes, routes, 3 * sizeof(uint16_t)) == 0);
+   
+   check(departure_cache_get(5678, cached, &num_departures, cached_routes, &num_routes, &fetched));
+   check(num_departures == 1);
+   
+   check(!departure_cache_get(999, cached, &num_departures, cached_routes, &num_routes, &fetched));
+}// End of test_cached_departures method
+
+int main(void)
+{
+   test_round_trip();
+   test_expiry();
+   test_short_read();
+   test_launch_to_ready();
+   test_cached_departures();
+   
+   if (s_failures) return 1;
+   
+   printf("nav_state: all checks passed\n");
+   return 0;
+}// End of main method
@@ -0,0 +1,59 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2014 Zachary Seguin
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+// Just enough of the Pebble SDK to build storage modules on the host for
+// make test. Persistent storage and the clock are faked by each test.
+
+#ifndef _pebble_h
+#define _pebble_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PERSIST_DATA_MAX_LENGTH 256
+
+typedef enum
+{
+   APP_LOG_LEVEL_ERROR = 1,
+   APP_LOG_LEVEL_WARNING = 50,
+   APP_LOG_LEVEL_INFO = 100,
+   APP_LOG_LEVEL_DEBUG = 200,
+   APP_LOG_LEVEL_DEBUG_VERBOSE = 255
+} AppLogLevel;
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...);
+
+bool persist_exists(const uint32_t key);
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+int persist_write_data(const uint32_t key, const void *data, const size_t size);
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+
+size_t heap_bytes_used(void);
+
+#endif
@@ -0,0 +1,100 @@
+#!/usr/bin/env node
+//
+// Checks the messages that patch the watch's timetable blocks: make test
+//
+
+var assert = require('assert');
+var path = require('path');
+
+// The app script registers its message handler on load
+global.Pebble = { addEventListener: function() {} };
+
+var app = require(path.join(__dirname, '..', 'src', 'js', 'pebble-js-app.js'));
+
+// Packs blocks [stop, crc, data] into the format written by
+// tools/compile_timetable.py for the watch
+function buildWatchTimetable(version, blocks)
+{
+   var offset = 12 + blocks.length * 12;
+   var length = blocks.reduce(function(total, block) { return total + block[2].length; }, offset);
+   var buffer = new ArrayBuffer(length);
+   var view = new DataView(buffer);
+
+   view.setUint32(0, 0x54545247, true); // 'GRTT'
+   view.setUint32(4, version, true);
+   view.setUint16(8, blocks.length, true);
+
+   blocks.forEach(function(block, x) {
+      var entry = 12 + x * 12;
+      view.setUint16(entry, block[0], true);
+      view.setUint16(entry + 2, block[1], true);
+      view.setUint16(entry + 4, block[2].length, true);
+      view.setUint32(entry + 8, offset, true);
+      new Uint8Array(buffer, offset, block[2].length).set(block[2]);
+      offset += block[2].length;
+   });
+
+   return buffer;
+}// End of buildWatchTimetable function
+
+function bytes(length, seed)
+{
+   var result = [];
+   for (var x = 0; x < length; ++x) result.push((x + seed) & 0xFF);
+   return result;
+}// End of bytes function
+
+// Decodes the 8 byte fragment header the watch reads before the data
+function fragment(message)
+{
+   var b = message.timetable_block;
+   return {
+      stop: b[0] | (b[1] << 8),
+      crc: b[2] | (b[3] << 8),
+      length: b[4] | (b[5] << 8),
+      offset: b[6] | (b[7] << 8),
+      data: b.slice(8)
+   };
+}// End of fragment function
+
+// Stop 100 is unchanged, 200 has changed and spans three chunks, 300 is new
+var block200 = bytes(300, 7);
+var tt = app.parseWatchTimetable(buildWatchTimetable(20141020, [
+   [100, 0x1111, bytes(10, 1)],
+   [200, 0x2222, block200],
+   [300, 0x3333, bytes(5, 3)]
+]));
+
+assert.strictEqual(tt.version, 20141020);
+assert.deepStrictEqual(tt.blocks.map(function(block) { return [block.stop, block.crc, block.data.length]; }),
+   [[100, 0x1111, 10], [200, 0x2222, 300], [300, 0x3333, 5]]);
+assert.deepStrictEqual(Array.from(tt.blocks[1].data), block200);
+
+// The watch has an old 200 and a stop 500 that has since been dropped
+var messages = app.timetablePatch(tt, [100, 0x1111, 200, 0x9999, 500, 0x5555]);
+
+assert.strictEqual(messages.length, 6);
+messages.forEach(function(message) {
+   assert.strictEqual(message.timetable_version, 20141020);
+});
+
+// The changed block goes in order, in chunks of at most 128 bytes
+var chunks = messages.slice(0, 3).map(fragment);
+assert.deepStrictEqual(chunks.map(function(f) { return [f.stop, f.crc, f.length, f.offset, f.data.length]; }),
+   [[200, 0x2222, 300, 0, 128], [200, 0x2222, 300, 128, 128], [200, 0x2222, 300, 256, 44]]);
+assert.deepStrictEqual([].concat(chunks[0].data, chunks[1].data, chunks[2].data), block200);
+
+// A new stop is sent whole
+assert.deepStrictEqual(fragment(messages[3]), { stop: 300, crc: 0x3333, length: 5, offset: 0, data: bytes(5, 3) });
+
+// A removed stop is an empty block with a zero checksum
+assert.deepStrictEqual(fragment(messages[4]), { stop: 500, crc: 0, length: 0, offset: 0, data: [] });
+
+// The commit counts blocks, not messages
+assert.deepStrictEqual(messages[5], { timetable_version: 20141020, timetable_commit: 3 });
+
+// A watch that is up to date only gets the commit
+assert.deepStrictEqual(app.timetablePatch(tt, [100, 0x1111, 200, 0x2222, 300, 0x3333]),
+   [{ timetable_version: 20141020, timetable_commit: 0 }]);
+
+console.log('timetable_patch: all checks passed');
@@ -0,0 +1,88 @@
+#!/usr/bin/env node
+//
+// Checks the phone-side trip planner on a small hand-built timetable: make test
+//
+
+var assert = require('assert');
+var path = require('path');
+
+// The app script registers its message handler on load
+global.Pebble = { addEventListener: function() {} };
+
+var app = require(path.join(__dirname, '..', 'src', 'js', 'pebble-js-app.js'));
+
+// Packs connections [departure, arrival, trip, from stop index, to stop index]
+// into the format written by tools/compile_timetable.py
+function buildTimetable(stopNumbers, tripRoutes, connections)
+{
+   var count = connections.length;
+   var length = 24 + count * 16 + stopNumbers.length * 2 + tripRoutes.length * 2;
+   var buffer = new ArrayBuffer(length);
+   var view = new DataView(buffer);
+   var offset = 24;
+
+   view.setUint32(0, 0x43545247, true); // 'GRTC'
+   view.setUint16(4, 1, true);
+   view.setUint32(8, 20141020, true);
+   view.setUint32(12, stopNumbers.length, true);
+   view.setUint32(16, tripRoutes.length, true);
+   view.setUint32(20, count, true);
+
+   for (var column = 0; column < 5; ++column)
+   {
+      connections.forEach(function(connection) {
+         if (column < 3) view.setUint32(offset, connection[column], true);
+         else view.setUint16(offset, connection[column], true);
+         offset += column < 3 ? 4 : 2;
+      });
+   }// End of for
+
+   stopNumbers.concat(tripRoutes).forEach(function(value) {
+      view.setUint16(offset, value, true);
+      offset += 2;
+   });
+
+   return buffer;
+}// End of buildTimetable function
+
+function time(hours, minutes, seconds)
+{
+   return hours * 3600 + minutes * 60 + (seconds || 0);
+}// End of time function
+
+// Stops 100, 200, 300 and 400. Route 7 runs 100 > 200 > 300. Route 12 leaves
+// 200 for 400 twice, 30 s and 2 min after route 7 arrives. Route 20 runs
+// 300 > 400 but arrives later.
+var tt = app.parseTimetable(buildTimetable([100, 200, 300, 400], [7, 12, 12, 20], [
+   [time(8, 0), time(8, 10), 0, 0, 1],
+   [time(8, 10), time(8, 20), 0, 1, 2],
+   [time(8, 10, 30), time(8, 30), 1, 1, 3],
+   [time(8, 12), time(8, 32), 2, 1, 3],
+   [time(8, 25), time(8, 40), 3, 2, 3]
+]));
+
+assert.strictEqual(tt.date, 20141020);
+assert.strictEqual(tt.numConnections, 5);
+
+// Too short a transfer is refused, so the trip waits for the later bus
+assert.deepStrictEqual(app.planTrip(tt, 100, 400, time(7, 55)), [
+   { route: 7, from: 100, to: 200, departure: time(8, 0), arrival: time(8, 10) },
+   { route: 12, from: 200, to: 400, departure: time(8, 12), arrival: time(8, 32) }
+]);
+
+// Staying on one bus past a stop is a single leg
+assert.deepStrictEqual(app.planTrip(tt, 100, 300, time(7, 55)), [
+   { route: 7, from: 100, to: 300, departure: time(8, 0), arrival: time(8, 20) }
+]);
+
+// Starting at the transfer stop, the first bus is fine
+assert.deepStrictEqual(app.planTrip(tt, 200, 400, time(8, 10)), [
+   { route: 12, from: 200, to: 400, departure: time(8, 10, 30), arrival: time(8, 30) }
+]);
+
+// Missed the last bus, unknown stops, and going nowhere
+assert.deepStrictEqual(app.planTrip(tt, 100, 400, time(8, 1)), []);
+assert.deepStrictEqual(app.planTrip(tt, 100, 999, time(7, 55)), []);
+assert.deepStrictEqual(app.planTrip(tt, 100, 100, time(7, 55)), []);
+
+console.log('trip_planner: all checks passed');
@@ -0,0 +1,290 @@
+#!/usr/bin/env python
+#
+# Compiles a GTFS feed into the connection table used by the phone-side
+# trip planner (src/js/pebble-js-app.js).
+#
+# Only trips running on the given service date are kept. Each pair of
+# consecutive stops on a trip becomes one connection, and connections are
+# sorted by departure time so a Connection Scan query reads them front to
+# back. The file is a little endian struct of arrays:
+#
+#   header      'GRTC', u16 version, u16 reserved, u32 service date (YYYYMMDD),
+#               u32 stops, u32 trips, u32 connections
+#   u32[conns]  departure time, seconds after midnight of the service date
+#   u32[conns]  arrival time
+#   u32[conns]  trip index
+#   u16[conns]  departure stop index
+#   u16[conns]  arrival stop index
+#   u16[stops]  stop number shown on the watch
+#   u16[trips]  route number
+#
+# Usage: compile_timetable.py GTFS_DIR_OR_ZIP YYYYMMDD OUTPUT
+#
+# With --watch, it instead compiles the scheduled departures of a few stops
+# into the timetable bundled with the watch app (src/timetable.h). Blocks
+# are per stop and carry a CRC so the phone can patch only the ones that
+# changed between feeds:
+#
+#   header      'GRTT', u32 version (YYYYMMDD of the feed), u16 blocks, u16 reserved
+#   index       per block: u16 stop number, u16 CRC-16/CCITT, u16 length,
+#               u16 reserved, u32 offset from the start of the file
+#   blocks      per departure: u16 minutes after midnight,
+#               u16 route | days << 13 (1 weekday, 2 Saturday, 4 Sunday)
+#
+# Usage: compile_timetable.py --watch GTFS_DIR_OR_ZIP YYYYMMDD STOP[,STOP...] OUTPUT
+#
+
+from __future__ import print_function
+
+import csv
+import datetime
+import io
+import os
+import re
+import struct
+import sys
+import zipfile
+
+MAGIC = b'GRTC'
+VERSION = 1
+
+WATCH_MAGIC = b'GRTT'
+WATCH_DAYS = (1, 2, 4) # weekday, Saturday, Sunday
+
+
+def read_table(feed, name):
+    """Yields each row of a GTFS table as a dict."""
+    if os.path.isdir(feed):
+        path = os.path.join(feed, name)
+        if not os.path.exists(path):
+            return
+        stream = io.open(path, encoding='utf-8-sig', newline='') if sys.version_info[0] >= 3 else open(path, 'rb')
+    else:
+        archive = zipfile.ZipFile(feed)
+        if name not in archive.namelist():
+            return
+        stream = archive.open(name)
+        if sys.version_info[0] >= 3:
+            stream = io.TextIOWrapper(stream, encoding='utf-8-sig', newline='')
+
+    with stream:
+        reader = csv.reader(stream)
+        header = [column.strip() for column in next(reader)]
+        if sys.version_info[0] < 3:
+            header = [column.lstrip('\xef\xbb\xbf') for column in header]
+
+        for row in reader:
+            yield dict(zip(header, (value.strip() for value in row)))
+
+
+def active_services(feed, date):
+    """Returns the service_ids running on a YYYYMMDD date."""
+    day = datetime.datetime.strptime(date, '%Y%m%d')
+    weekday = ('monday', 'tuesday', 'wednesday', 'thursday', 'friday', 'saturday', 'sunday')[day.weekday()]
+
+    services = set()
+    for row in read_table(feed, 'calendar.txt'):
+        if row['start_date'] <= date <= row['end_date'] and row[weekday] == '1':
+            services.add(row['service_id'])
+
+    for row in read_table(feed, 'calendar_dates.txt'):
+        if row['date'] != date:
+            continue
+        if row['exception_type'] == '1':
+            services.add(row['service_id'])
+        elif row['exception_type'] == '2':
+            services.discard(row['service_id'])
+
+    return services
+
+
+def parse_time(value):
+    """Returns seconds after midnight for a GTFS HH:MM:SS time, or None."""
+    if not value:
+        return None
+
+    hours, minutes, seconds = value.split(':')
+    return int(hours) * 3600 + int(minutes) * 60 + int(seconds)
+
+
+def number(value):
+    """Returns the leading number in an id or name, or 0."""
+    match = re.search(r'\d+', value or '')
+    return int(match.group(0)) if match and int(match.group(0)) < 65536 else 0
+
+
+def compile_feed(feed, date):
+    services = active_services(feed, date)
+
+    routes = dict((row['route_id'], number(row.get('route_short_name'))) for row in read_table(feed, 'routes.txt'))
+
+    trips = {}
+    trip_routes = []
+    for row in read_table(feed, 'trips.txt'):
+        if row['service_id'] in services:
+            trips[row['trip_id']] = len(trip_routes)
+            trip_routes.append(routes.get(row['route_id'], 0))
+
+    stops = {}
+    stop_numbers = []
+    for row in read_table(feed, 'stops.txt'):
+        stops[row['stop_id']] = len(stop_numbers)
+        stop_numbers.append(number(row.get('stop_code')) or number(row['stop_id']))
+
+    if len(stop_numbers) >= 65536:
+        raise ValueError('Too many stops for 16 bit indexes: %d' % len(stop_numbers))
+
+    stop_times = {}
+    for row in read_table(feed, 'stop_times.txt'):
+        trip = trips.get(row['trip_id'])
+        if trip is None:
+            continue
+
+        stop_times.setdefault(trip, []).append((int(row['stop_sequence']),
+                                                stops[row['stop_id']],
+                                                parse_time(row['arrival_time']),
+                                                parse_time(row['departure_time'])))
+
+    connections = []
+    for trip, times in stop_times.items():
+        times.sort()
+        for (_, from_stop, _, departure), (_, to_stop, arrival, _) in zip(times, times[1:]):
+            # Untimed stops are skipped rather than interpolated
+            if departure is None or arrival is None:
+                continue
+            connections.append((departure, arrival, trip, from_stop, to_stop))
+
+    connections.sort()
+
+    return stop_numbers, trip_routes, connections
+
+
+def crc16(data):
+    """CRC-16/CCITT, as computed by src/timetable.c."""
+    crc = 0xFFFF
+    for byte in bytearray(data):
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def representative_dates(date):
+    """Returns the first weekday, Saturday and Sunday on or after a date."""
+    day = datetime.datetime.strptime(date, '%Y%m%d')
+    dates = [None, None, None]
+
+    for offset in range(7):
+        current = day + datetime.timedelta(days=offset)
+        kind = 0 if current.weekday() < 5 else current.weekday() - 4
+        if dates[kind] is None:
+            dates[kind] = current.strftime('%Y%m%d')
+
+    return dates
+
+
+def compile_watch_feed(feed, date, stop_numbers):
+    routes = dict((row['route_id'], number(row.get('route_short_name'))) for row in read_table(feed, 'routes.txt'))
+
+    # Days each trip runs on, from one representative date of each kind
+    services = [active_services(feed, day) for day in representative_dates(date)]
+    trips = {}
+    for row in read_table(feed, 'trips.txt'):
+        days = sum(bit for bit, active in zip(WATCH_DAYS, services) if row['service_id'] in active)
+        if days:
+            trips[row['trip_id']] = (routes.get(row['route_id'], 0), days)
+
+    wanted = {}
+    for row in read_table(feed, 'stops.txt'):
+        stop = number(row.get('stop_code')) or number(row['stop_id'])
+        if stop in stop_numbers:
+            wanted[row['stop_id']] = stop
+
+    candidates = []
+    last_sequences = {}
+    for row in read_table(feed, 'stop_times.txt'):
+        if row['trip_id'] not in trips:
+            continue
+
+        sequence = int(row['stop_sequence'])
+        last_sequences[row['trip_id']] = max(sequence, last_sequences.get(row['trip_id'], sequence))
+
+        departure = parse_time(row['departure_time'])
+        if row['stop_id'] in wanted and departure is not None:
+            candidates.append((row['trip_id'], sequence, wanted[row['stop_id']], departure // 60))
+
+    departures = dict((stop, {}) for stop in stop_numbers)
+    for trip_id, sequence, stop, minutes in candidates:
+        # Buses end their trip at the last stop, they don't depart from it
+        if sequence == last_sequences[trip_id]:
+            continue
+
+        route, days = trips[trip_id]
+        departures[stop][(minutes, route)] = departures[stop].get((minutes, route), 0) | days
+
+    blocks = []
+    for stop in stop_numbers:
+        data = b''.join(struct.pack('<HH', minutes, route | days << 13)
+                        for (minutes, route), days in sorted(departures[stop].items()))
+        blocks.append((stop, data))
+
+    return blocks
+
+
+def write_watch_timetable(path, version, blocks):
+    with open(path, 'wb') as f:
+        f.write(WATCH_MAGIC)
+        f.write(struct.pack('<IHH', int(version), len(blocks), 0))
+
+        offset = 12 + 12 * len(blocks)
+        for stop, data in blocks:
+            f.write(struct.pack('<HHHHI', stop, crc16(data), len(data), 0, offset))
+            offset += len(data)
+
+        for _, data in blocks:
+            f.write(data)
+
+
+def write_timetable(path, date, stop_numbers, trip_routes, connections):
+    count = len(connections)
+
+    with open(path, 'wb') as f:
+        f.write(MAGIC)
+        f.write(struct.pack('<HHIIII', VERSION, 0, int(date), len(stop_numbers), len(trip_routes), count))
+
+        for column in range(5):
+            fmt = '<%d%s' % (count, 'I' if column < 3 else 'H')
+            f.write(struct.pack(fmt, *(connection[column] for connection in connections)))
+
+        f.write(struct.pack('<%dH' % len(stop_numbers), *stop_numbers))
+        f.write(struct.pack('<%dH' % len(trip_routes), *trip_routes))
+
+
+def main(argv):
+    if argv[:1] == ['--watch'] and len(argv) == 5:
+        _, feed, date, stops, output = argv
+
+        blocks = compile_watch_feed(feed, date, [int(stop) for stop in stops.split(',') if stop])
+        write_watch_timetable(output, date, blocks)
+
+        print('%s: %d stops, %d bytes' % (output, len(blocks), os.path.getsize(output)))
+        return 0
+
+    if len(argv) != 3:
+        print('Usage: compile_timetable.py GTFS_DIR_OR_ZIP YYYYMMDD OUTPUT', file=sys.stderr)
+        return 2
+
+    feed, date, output = argv
+
+    stop_numbers, trip_routes, connections = compile_feed(feed, date)
+    write_timetable(output, date, stop_numbers, trip_routes, connections)
+
+    print('%s: %d stops, %d trips, %d connections, %d bytes' %
+          (output, len(stop_numbers), len(trip_routes), len(connections), os.path.getsize(output)))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
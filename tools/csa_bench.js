@@ -0,0 +1,73 @@
+#!/usr/bin/env node
+//
+// Measures trip planner queries per second over a compiled timetable.
+//
+// Usage: node tools/csa_bench.js TIMETABLE [QUERIES]
+//
+// Queries run between random stops that have departures, leaving at random
+// times between 06:00 and 22:00, with the same planner the phone runs.
+//
+
+var fs = require('fs');
+var path = require('path');
+
+// The app script registers its message handler on load
+global.Pebble = { addEventListener: function() {} };
+
+var app = require(path.join(__dirname, '..', 'src', 'js', 'pebble-js-app.js'));
+
+function main(argv)
+{
+   if (argv.length < 1)
+   {
+      console.error('Usage: node tools/csa_bench.js TIMETABLE [QUERIES]');
+      return 2;
+   }// End of if
+
+   var queries = parseInt(argv[1] || '1000', 10);
+
+   var file = fs.readFileSync(argv[0]);
+   var buffer = file.buffer.slice(file.byteOffset, file.byteOffset + file.byteLength);
+
+   var start = process.hrtime();
+   var tt = app.parseTimetable(buffer);
+   var elapsed = process.hrtime(start);
+
+   console.log('Timetable ' + tt.date + ': ' + tt.numStops + ' stops, ' + tt.numTrips + ' trips, ' +
+               tt.numConnections + ' connections, ' + buffer.byteLength + ' bytes');
+   console.log('Parsed in ' + (elapsed[0] * 1e3 + elapsed[1] / 1e6).toFixed(1) + ' ms');
+
+   var served = {};
+   for (var x = 0; x < tt.numConnections; ++x) served[tt.stopNumbers[tt.fromStops[x]]] = true;
+   var stops = Object.keys(served).map(Number);
+
+   // Fixed seed so runs are comparable
+   var seed = 1;
+   function random(n)
+   {
+      seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF;
+      return seed % n;
+   }// End of random function
+
+   var found = 0;
+   var legs = 0;
+
+   start = process.hrtime();
+   for (var query = 0; query < queries; ++query)
+   {
+      var trip = app.planTrip(tt, stops[random(stops.length)], stops[random(stops.length)], 6 * 3600 + random(16 * 3600));
+
+      if (trip.length > 0) ++found;
+      legs += trip.length;
+   }// End of for
+   elapsed = process.hrtime(start);
+
+   var seconds = elapsed[0] + elapsed[1] / 1e9;
+
+   console.log(queries + ' queries in ' + seconds.toFixed(3) + ' s: ' + (queries / seconds).toFixed(1) + ' queries/s');
+   console.log(found + ' trips found, ' + (found ? (legs / found).toFixed(2) : 0) + ' legs on average');
+
+   return 0;
+}// End of main function
+
+process.exitCode = main(process.argv.slice(2));
@@ -0,0 +1,197 @@
+#!/usr/bin/env python
+#
+# Reports how much of the watch's code and RAM budget the app uses.
+#
+# Section sizes are read straight from the linked ELF and from each
+# module's object file, so text/data/bss can be attributed to the
+# src/*.c file that owns them. Whatever is left over (libc, SDK stubs,
+# alignment padding) is reported as "(other)".
+#
+# Peak heap usage is taken from an app log (`pebble logs > heap.log`)
+# containing the "Heap used" lines written by the heap_usage() macro.
+# Without one, the heap and total budgets are reported as unchecked, and
+# --require-heap turns that into a failure.
+#
+# Usage: size_report.py [--budget budget.json] [--heap-log heap.log] [--require-heap] build
+#
+
+from __future__ import print_function
+
+import json
+import os
+import re
+import struct
+import sys
+
+ELF_NAME = 'pebble-app.elf'
+
+SHT_NOBITS = 8
+
+SHF_WRITE = 0x1
+SHF_ALLOC = 0x2
+SHF_EXECINSTR = 0x4
+
+KINDS = ('text', 'data', 'bss')
+
+HEAP_LINE = re.compile(r'Heap used \(([^)]*)\): (\d+) bytes')
+
+# Budgets that can't be checked without a heap log
+HEAP_KEYS = ('heap', 'total')
+
+
+def section_sizes(path):
+    """Returns a dict of text/data/bss byte counts for an ELF file."""
+    with open(path, 'rb') as f:
+        image = f.read()
+
+    if image[:4] != b'\x7fELF':
+        raise ValueError('%s is not an ELF file' % path)
+
+    is64 = image[4:5] == b'\x02'
+    endian = '<' if image[5:6] == b'\x01' else '>'
+
+    if is64:
+        shoff, = struct.unpack_from(endian + 'Q', image, 0x28)
+        shentsize, shnum = struct.unpack_from(endian + 'HH', image, 0x3A)
+        header = endian + 'IIQQQQIIQQ'
+    else:
+        shoff, = struct.unpack_from(endian + 'I', image, 0x20)
+        shentsize, shnum = struct.unpack_from(endian + 'HH', image, 0x2E)
+        header = endian + 'IIIIIIIIII'
+
+    sizes = dict((kind, 0) for kind in KINDS)
+
+    for index in range(shnum):
+        fields = struct.unpack_from(header, image, shoff + index * shentsize)
+        sh_type, sh_flags, sh_size = fields[1], fields[2], fields[5]
+
+        if not sh_flags & SHF_ALLOC:
+            continue
+
+        if sh_type == SHT_NOBITS:
+            sizes['bss'] += sh_size
+        elif sh_flags & SHF_WRITE:
+            sizes['data'] += sh_size
+        else:
+            # Read-only data ships in the code image alongside the text
+            sizes['text'] += sh_size
+
+    return sizes
+
+
+def module_objects(build_dir):
+    """Maps each src/*.c module name to its object file in the build dir."""
+    objects = {}
+    src_dir = os.path.join(build_dir, 'src')
+
+    for root, _, files in os.walk(src_dir):
+        for name in files:
+            # waf names objects <file>.c.<task index>.o
+            match = re.match(r'(.+)\.c(\.\d+)?\.o$', name)
+            if match:
+                module = os.path.relpath(os.path.join(root, match.group(1)), src_dir)
+                objects[module] = os.path.join(root, name)
+
+    return objects
+
+
+def peak_heap(log_path):
+    """Returns (bytes, label) for the largest heap usage in a log, or None."""
+    if not log_path or not os.path.exists(log_path):
+        return None
+
+    peak = None
+    with open(log_path) as f:
+        for line in f:
+            match = HEAP_LINE.search(line)
+            if match and (peak is None or int(match.group(2)) > peak[0]):
+                peak = (int(match.group(2)), match.group(1))
+
+    return peak
+
+
+def report(build_dir, budget=None, heap_log=None, require_heap=False):
+    """Builds the report. Returns (lines, failures)."""
+    totals = section_sizes(os.path.join(build_dir, ELF_NAME))
+    modules = dict((module, section_sizes(path)) for module, path in module_objects(build_dir).items())
+
+    other = dict((kind, max(0, totals[kind] - sum(sizes[kind] for sizes in modules.values()))) for kind in KINDS)
+
+    lines = ['%-24s %8s %8s %8s' % ('module', 'text', 'data', 'bss')]
+    for module in sorted(modules):
+        sizes = modules[module]
+        lines.append('%-24s %8d %8d %8d' % (module, sizes['text'], sizes['data'], sizes['bss']))
+    lines.append('%-24s %8d %8d %8d' % ('(other)', other['text'], other['data'], other['bss']))
+    lines.append('%-24s %8d %8d %8d' % ('total', totals['text'], totals['data'], totals['bss']))
+    lines.append('')
+
+    heap = peak_heap(heap_log)
+    if heap:
+        lines.append('Peak heap: %d bytes (%s)' % heap)
+    else:
+        lines.append('Peak heap: unknown (no heap log)')
+
+    usage = dict(totals)
+    usage['heap'] = heap[0] if heap else 0
+    usage['total'] = sum(usage[kind] for kind in KINDS) + usage['heap']
+
+    failures = []
+    for key in sorted((budget or {}).keys()):
+        if key not in usage:
+            failures.append('Unknown budget key: %s' % key)
+            continue
+
+        if key in HEAP_KEYS and not heap:
+            lines.append('Budget %-6s %8s / %8d unchecked' % (key, '?', budget[key]))
+            if require_heap:
+                failures.append('%s budget needs a heap log' % key)
+            continue
+
+        status = 'ok' if usage[key] <= budget[key] else 'OVER'
+        lines.append('Budget %-6s %8d / %8d %s' % (key, usage[key], budget[key], status))
+
+        if status != 'ok':
+            failures.append('%s uses %d bytes, budget is %d' % (key, usage[key], budget[key]))
+
+    return lines, failures
+
+
+def load_budget(path):
+    if not path or not os.path.exists(path):
+        return None
+
+    with open(path) as f:
+        return json.load(f)
+
+
+def main(argv):
+    budget_path = None
+    heap_log = None
+    require_heap = False
+    args = list(argv)
+
+    while args and args[0].startswith('--'):
+        option = args.pop(0)
+        if option == '--budget':
+            budget_path = args.pop(0)
+        elif option == '--heap-log':
+            heap_log = args.pop(0)
+        elif option == '--require-heap':
+            require_heap = True
+        else:
+            print('Unknown option: %s' % option, file=sys.stderr)
+            return 2
+
+    build_dir = args[0] if args else 'build'
+
+    lines, failures = report(build_dir, load_budget(budget_path), heap_log, require_heap)
+    print('\n'.join(lines))
+
+    for failure in failures:
+        print('error: %s' % failure, file=sys.stderr)
+
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))